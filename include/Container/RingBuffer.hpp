@@ -454,6 +454,25 @@ namespace Container
             Zero(buffer);
 #endif
         }
+        /** Move the transcient data to the vault and empty the transcient buffer.
+            This is used to keep data that's already received while the transcient buffer is used for something else.
+            @param from     The position of the data to keep in the transcient buffer, the data before it isn't modified
+            @return the size of the kept data, to be given to restoreTranscient later on */
+        uint32 stashTranscient(const uint32 from = 0)
+        {
+            uint32 size = from < w ? w - from : 0;
+            memmove(&buffer[v - size], &buffer[from], size);
+            v -= size; w = 0;
+            return size;
+        }
+        /** Reset the buffer and restore the transcient data that was stashed with stashTranscient
+            @param size     The stashed size
+            @param vault    The vault's size right after stashing (more data could have been saved in the vault since then) */
+        void restoreTranscient(const uint32 size, const uint32 vault)
+        {
+            memmove(buffer, &buffer[sizePowerOf2 - vault], size);
+            w = size; v = sizePowerOf2;
+        }
         /** Persist data to the vault */
         bool saveInVault(const uint8 * packet, uint32 size)
         {
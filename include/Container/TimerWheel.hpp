@@ -0,0 +1,134 @@
+#ifndef hpp_TimerWheel_hpp
+#define hpp_TimerWheel_hpp
+
+// We need types
+#include "Types.hpp"
+// We need clock_gettime
+#include <time.h>
+
+namespace Container
+{
+    /** Get the current monotonic time in milliseconds (it wraps around every 49 days, so only use differences) */
+    static inline uint32 getMonotonicTimeMs()
+    {
+        struct timespec ts = {};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32)((uint64)ts.tv_sec * 1000 + (uint64)(ts.tv_nsec / 1000000));
+    }
+
+    /** A hierarchical timer wheel for a fixed number of timers (identified by their index, from 0 to N-1).
+        Timers are stored in intrusive double linked lists, one per wheel slot, so there's no allocation.
+        The first level has a TickMs resolution, each upper level is Slots times coarser. When the lower level wraps around,
+        the timers in the current slot of the upper level are cascaded down.
+        Scheduling and cancelling a timer is O(1), advancing the wheel is O(elapsed ticks + expired timers), independent of N.
+        @param N        The number of timers
+        @param TickMs   The duration of a tick in milliseconds (timers can't be more precise than this) */
+    template <std::size_t N, uint32 TickMs = 16>
+    struct TimerWheel
+    {
+        static_assert(N < 65535, "Too many timers for this wheel");
+        static constexpr uint32 Levels = 4;
+        static constexpr uint32 SlotBits = 6;
+        static constexpr uint32 Slots = 1U << SlotBits;
+        static constexpr uint32 SlotMask = Slots - 1;
+        /** The maximum delay (in ticks) that can be stored in the wheel */
+        static constexpr uint32 MaxTicks = (1U << (SlotBits * Levels)) - 1;
+        static constexpr uint16 None = 0xFFFF;
+
+        /** The first timer in each slot */
+        uint16  head[Levels * Slots];
+        /** The next and previous timer in the slot's list */
+        uint16  next[N], prev[N];
+        /** The slot each timer is stored in (or None if not armed) */
+        uint16  slot[N];
+        /** The expiry time in ticks */
+        uint32  expiry[N];
+        /** The current time in ticks */
+        uint32  now;
+
+        /** Check if the given timer is armed */
+        bool isArmed(const std::size_t i) const { return slot[i] != None; }
+
+        /** Schedule (or reschedule) the given timer to expire in delayMs milliseconds */
+        void schedule(const std::size_t i, const uint32 delayMs)
+        {
+            cancel(i);
+            uint32 ticks = (delayMs + TickMs - 1) / TickMs;
+            expiry[i] = now + (ticks ? (ticks > MaxTicks ? MaxTicks : ticks) : 1);
+            insert(i);
+        }
+        /** Cancel the given timer (it's safe to call on a disarmed timer) */
+        void cancel(const std::size_t i)
+        {
+            if (slot[i] == None) return;
+            if (prev[i] != None) next[prev[i]] = next[i];
+            else head[slot[i]] = next[i];
+            if (next[i] != None) prev[next[i]] = prev[i];
+            slot[i] = next[i] = prev[i] = None;
+        }
+
+        /** Advance the wheel up to the given time and call the callback for each expired timer.
+            The timer is disarmed before calling the callback, so it can be rescheduled from there
+            @param nowMs    The current time in milliseconds, from the same clock as the one given in the constructor (see getMonotonicTimeMs)
+            @param expired  A callback with a void (std::size_t index) signature */
+        template <typename Func>
+        void advance(const uint32 nowMs, Func && expired)
+        {
+            // Use the elapsed time since the last tick so the millisecond clock can wrap around
+            uint32 ticks = (nowMs - lastMs) / TickMs;
+            lastMs += ticks * TickMs;
+            while (ticks--)
+            {
+                ++now;
+                // Cascade the upper levels when the lower level wraps around
+                for (uint32 l = 1; l < Levels && !(now & ((1U << (SlotBits * l)) - 1)); l++)
+                    cascade(l);
+
+                uint16 & h = head[now & SlotMask];
+                while (h != None)
+                {
+                    std::size_t i = h;
+                    cancel(i);
+                    expired(i);
+                }
+            }
+        }
+
+        /** Build a timer wheel starting at the given time (in milliseconds) */
+        TimerWheel(const uint32 nowMs = getMonotonicTimeMs()) : now(0), lastMs(nowMs)
+        {
+            for (auto & h : head) h = None;
+            for (std::size_t i = 0; i < N; i++) next[i] = prev[i] = slot[i] = None;
+        }
+
+    private:
+        /** The time of the last tick in milliseconds */
+        uint32  lastMs;
+
+        /** Insert the given timer in the slot matching its expiry time */
+        void insert(const std::size_t i)
+        {
+            uint32 delta = expiry[i] - now, l = 0;
+            while (l < Levels - 1 && delta >= (1U << (SlotBits * (l + 1)))) l++;
+            uint16 s = (uint16)(l * Slots + ((expiry[i] >> (SlotBits * l)) & SlotMask));
+            slot[i] = s;
+            prev[i] = None;
+            next[i] = head[s];
+            if (head[s] != None) prev[head[s]] = (uint16)i;
+            head[s] = (uint16)i;
+        }
+        /** Move all timers in the current slot of the given level to the lower levels */
+        void cascade(const uint32 level)
+        {
+            uint16 & h = head[level * Slots + ((now >> (SlotBits * level)) & SlotMask)];
+            while (h != None)
+            {
+                std::size_t i = h;
+                cancel(i);
+                insert(i);
+            }
+        }
+    };
+}
+
+#endif
@@ -49,6 +49,83 @@
     Default: 0 */
 #define MaxSupport            CONFIG_ESP_EHTTPD_MAX_SUPPORT
 
+/** Accept all pending connections on each server loop instead of a single one.
+    When all client slots are used, the pending connections are answered with a 503 error and closed right away
+    instead of waiting in the kernel's backlog.
+
+    Default: 1 */
+#define BatchAccept           CONFIG_ESP_EHTTPD_BATCH_ACCEPT
+
+/** The maximum time in milliseconds an idle connection is kept open between two requests
+    Default: 5000 */
+#ifdef CONFIG_ESP_EHTTPD_KEEPALIVE_TIMEOUT_MS
+  #define KeepAliveTimeoutMs  CONFIG_ESP_EHTTPD_KEEPALIVE_TIMEOUT_MS
+#else
+  #define KeepAliveTimeoutMs  5000
+#endif
+
+/** The maximum time in milliseconds to receive a complete request line and headers.
+    This isn't extended when receiving data, so a client sending its headers very slowly can't hold a client slot forever.
+    Default: 10000 */
+#ifdef CONFIG_ESP_EHTTPD_HEADER_TIMEOUT_MS
+  #define HeaderReadTimeoutMs CONFIG_ESP_EHTTPD_HEADER_TIMEOUT_MS
+#else
+  #define HeaderReadTimeoutMs 10000
+#endif
+
+/** The maximum time in milliseconds without progress while receiving a request's body or sending an answer
+    Default: 30000 */
+#ifdef CONFIG_ESP_EHTTPD_BODY_TIMEOUT_MS
+  #define BodyTimeoutMs       CONFIG_ESP_EHTTPD_BODY_TIMEOUT_MS
+#else
+  #define BodyTimeoutMs       30000
+#endif
+
+/** The size of the chunks sent for an answer that's produced on the fly (like a CaptureAnswer).
+    The produced fragments are coalesced in the client's receive buffer and sent as a single chunk once this size is reached.
+    0 means when the receive buffer is full, 1 sends each fragment as soon as it's produced.
+    Default: 0 */
+#ifdef CONFIG_ESP_EHTTPD_CHUNK_FLUSH_SIZE
+  #define ChunkFlushSize      CONFIG_ESP_EHTTPD_CHUNK_FLUSH_SIZE
+#else
+  #define ChunkFlushSize      0
+#endif
+
+/** Send the Date header with every answer (RFC9110 6.6.1 requires it for caches).
+    The date is formatted once per second by the server's loop, not for each answer. It's not sent until the system clock is set (like with SNTP).
+    Default: 1 */
+#define SendDateHeader        CONFIG_ESP_EHTTPD_DATE_HEADER
+
+/** The name sent in the Server header of every answer. If empty, no Server header is sent.
+    Default: "eHTTPd" */
+#ifdef CONFIG_ESP_EHTTPD_SERVER_NAME
+  #define ServerName          CONFIG_ESP_EHTTPD_SERVER_NAME
+#else
+  #define ServerName          "eHTTPd"
+#endif
+
+/** The maximum number of parameters captured by a route's pattern (like "/api/device/:id/sensor/:name").
+    Each client stores the captures of its current request (as views on the requested path, not copies).
+    Default: 4 */
+#ifdef CONFIG_ESP_EHTTPD_MAX_ROUTE_CAPTURES
+  #define MaxRouteCaptures    CONFIG_ESP_EHTTPD_MAX_ROUTE_CAPTURES
+#else
+  #define MaxRouteCaptures    4
+#endif
+
+/** Use epoll to monitor the sockets instead of select.
+    Select rebuilds and scans the whole socket set on each loop and is limited to FD_SETSIZE descriptors, epoll only
+    reports the active sockets. This is only available on Linux hosts (not on lwIP based targets like ESP32).
+
+    Default: 0 */
+#if defined(__linux__)
+  #define LinuxHost           1
+  #define UseEpoll            CONFIG_ESP_EHTTPD_USE_EPOLL
+#else
+  #define LinuxHost           0
+  #define UseEpoll            0
+#endif
+
 #if UseTLSServer == 1 || UseTLSClient == 1
   #define UseTLS 1
 #else
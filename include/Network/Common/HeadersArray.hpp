@@ -25,6 +25,118 @@ namespace Network::Common::HTTP
         template <Headers E> struct MakeRequest { typedef Protocol::HTTP::RequestHeader<E> Type; };
         // Convert a std::array of headers to a parametric answer list
         template <Headers E> struct MakeAnswer { typedef Protocol::HTTP::AnswerHeader<E> Type; };
+
+        /** Fold an ASCII letter to lower case, since the header names are case insensitive */
+        constexpr uint8 foldCase(const char c) { return (uint8)(c >= 'A' && c <= 'Z' ? c | 0x20 : c); }
+        /** The case insensitive hash of a header name */
+        constexpr uint32 headerNameHash(const char * name, const std::size_t length)
+        {
+            uint32 h = 2166136261U;
+            for (std::size_t i = 0; i < length; i++) { h ^= foldCase(name[i]); h *= 16777619U; }
+            return h;
+        }
+        constexpr std::size_t nameLength(const char * name) { std::size_t n = 0; while (name[n]) n++; return n; }
+
+        /** A minimal perfect hash over distinct 32 bits hashes, built at compile time with hash and displace (like ROMAssets):
+            the hash selects a bucket, then the bucket's seed selects the slot. The seeds are searched bucket by bucket, the largest first,
+            and each search is bounded so the construction always finishes in (almost) linear time, whatever the count */
+        template <std::size_t Count>
+        struct PerfectHash
+        {
+            /** The table's size, a power of 2 at least twice the count, so a bucket's seed is found in a few tries */
+            static constexpr uint32 SizeLog = [] { uint32 l = 1; while (((std::size_t)1 << l) < 2 * Count) l++; return l; }();
+            static constexpr std::size_t Size = (std::size_t)1 << SizeLog;
+            /** About 2 hashes per bucket */
+            static constexpr uint32 BucketLog = SizeLog > 2 ? SizeLog - 2 : 0;
+            static constexpr std::size_t BucketCount = (std::size_t)1 << BucketLog;
+            /** The maximum number of seeds tried for a bucket */
+            static constexpr uint32 MaxTries = 65536;
+            static_assert(Count < 255, "Too many entries for the perfect hash");
+
+            /** The entry in each slot (plus one, 0 being empty) */
+            uint8  index[Size];
+            /** The seed of each bucket */
+            uint16 seeds[BucketCount];
+            /** Set if a seed was found for each bucket, it's only false if some hashes are equal */
+            bool   built;
+
+            static constexpr uint32 bucket(const uint32 hash) { return BucketLog ? (hash * 0x9E3779B1U) >> (32 - BucketLog) : 0; }
+            static constexpr uint32 slot(const uint32 hash, const uint32 seed) { return ((hash ^ (seed * 0x9E3779B1U)) * 0x85EBCA6BU) >> (32 - SizeLog); }
+
+            /** Find the entry for the given hash
+                @return The entry's position (if it's in the table, the caller must confirm the key), or Count if it's not */
+            constexpr std::size_t find(const uint32 hash) const
+            {
+                const uint8 e = index[slot(hash, seeds[bucket(hash)])];
+                return e ? e - 1 : Count;
+            }
+
+            constexpr PerfectHash(const std::array<uint32, Count> & hashes) : index(), seeds(), built(true)
+            {
+                uint8 sizes[BucketCount] = {}, largest = 0;
+                for (std::size_t i = 0; i < Count; i++)
+                    if (++sizes[bucket(hashes[i])] > largest) largest = sizes[bucket(hashes[i])];
+                for (uint8 n = largest; n; n--)
+                    for (uint32 b = 0; b < BucketCount; b++)
+                        if (sizes[b] == n && !place(hashes, b)) { built = false; return; }
+            }
+
+        private:
+            /** Search a seed placing all the bucket's hashes in empty slots */
+            constexpr bool place(const std::array<uint32, Count> & hashes, const uint32 b)
+            {
+                uint8 members[Count ? Count : 1] = {}, count = 0;
+                for (std::size_t i = 0; i < Count; i++) if (bucket(hashes[i]) == b) members[count++] = (uint8)i;
+                for (uint32 seed = 0; seed < MaxTries; seed++)
+                {
+                    uint8 i = 0;
+                    for (; i < count; i++)
+                    {
+                        uint8 & e = index[slot(hashes[members[i]], seed)];
+                        if (e) break;
+                        e = (uint8)(members[i] + 1);
+                    }
+                    if (i == count) { seeds[b] = (uint16)seed; return true; }
+                    // Collision, so free the slots used with this seed
+                    while (i) index[slot(hashes[members[--i]], seed)] = 0;
+                }
+                return false;
+            }
+        };
+
+        /** A minimal perfect hash over the names of the given headers, built at compile time.
+            Recognizing a name costs a hash and a single (case insensitive) comparison, whatever the header count */
+        template <auto headerArray>
+        struct HeadersNameHash
+        {
+            static constexpr std::size_t Count = headerArray.size();
+            static_assert(Count < 255, "Too many headers for a route");
+
+            static constexpr PerfectHash<Count> table{[] {
+                std::array<uint32, Count> hashes = {};
+                for (std::size_t i = 0; i < Count; i++)
+                {
+                    const char * name = Refl::toString(headerArray[i]);
+                    hashes[i] = headerNameHash(name, nameLength(name));
+                }
+                return hashes;
+            }()};
+            static_assert(table.built, "Some header names have the same hash, change headerNameHash");
+
+            /** Find the given header name
+                @return The header's position in the array, or the header count if not found */
+            static std::size_t find(const ROString & header)
+            {
+                const char * name = header.getData();
+                const std::size_t length = (std::size_t)header.getLength();
+                const std::size_t pos = table.find(headerNameHash(name, length));
+                if (pos == Count) return Count;
+                const char * expected = Refl::toString(headerArray[pos]);
+                for (std::size_t i = 0; i < length; i++)
+                    if (!expected[i] || foldCase(expected[i]) != foldCase(name[i])) return Count;
+                return expected[length] ? Count : pos;
+            }
+        };
     }
 
     // Useless vomit of useless garbage to get the inner content of a typelist
@@ -53,6 +165,8 @@ namespace Network::Common::HTTP
             for(; pos < headerArray.size(); ++pos) if (headerArray[pos] == h) break;
             return pos;
         }
+        /** Check if the given header is in this array, at compile time (getHeader doesn't compile for a missing header) */
+        static constexpr bool hasHeader(const Headers h) { return findHeaderPos(h) < headerArray.size(); }
         // Compile time version, faster O(1) at runtime, and smaller, obviously
         template <Headers h>
         RequestHeader<h> & getHeader()
@@ -80,22 +194,20 @@ namespace Network::Common::HTTP
             return std::get<pos>(headers);
         }
 
-        // Runtime version to test if we are interested in a specific header (speed up O(M*N) search to O(m*N) search instead)
+        // Runtime version to test if we are interested in a specific header, with a perfect hash over the headers we are interested in (O(1) instead of O(N))
         Headers acceptHeader(const ROString & header)
         {
-            // Only search for headers we are interested in
-            for(std::size_t pos = 0; pos < headerArray.size(); ++pos)
-                if (header == Refl::toString(headerArray[pos])) return headerArray[pos];
-
-            return Headers::Invalid;
+            const std::size_t pos = Details::HeadersNameHash<headerArray>::find(header);
+            return pos < headerArray.size() ? headerArray[pos] : Headers::Invalid;
         }
 
         // Runtime version to accept header and parse the value in the expected element
         ParsingError acceptAndParse(const ROString & header, ROString & input)
         {
             ParsingError err = InvalidRequest;
+            const std::size_t pos = Details::HeadersNameHash<headerArray>::find(header);
             [&]<std::size_t... Is>(std::index_sequence<Is...>)  {
-                return ((header == Refl::toString(headerArray[Is]) ? (err = std::get<Is>(headers).acceptValue(input), true) : false) || ...);
+                return ((pos == Is ? (err = std::get<Is>(headers).acceptValue(input), true) : false) || ...);
             }(std::make_index_sequence<sizeof...(Header)>{});
             return err;
         }
@@ -293,6 +405,10 @@ namespace Network::Common::HTTP
         static constexpr auto headersArray = Container::getUnique<std::array<Headers, sizeof...(answerHeaders)>{answerHeaders...}, std::array{Headers::WWWAuthenticate}>();
         typedef AnswerHeadersArray<headersArray, decltype(Container::makeTypes<Details::MakeAnswer, headersArray>())> Type;
     };
+
+    /** Check if the given request headers type contains the given header, so it can be queried */
+    template <typename H, Headers h>
+    concept HasHeader = requires { requires std::decay_t<H>::hasHeader(h); };
 }
 
 
@@ -32,6 +32,9 @@ namespace Network
         BadSocketType,              //!< Bad socket type
         Timeout,                    //!< The operation timed out
         AllocationFailure,          //!< An allocation failed or misbehaved
+        WouldBlock,                 //!< The operation would block (and the socket is non blocking)
+        Aborted,                    //!< The pending connection was aborted (or the call interrupted) before it was accepted, try the next one
+        OutOfResources,             //!< The system is out of file descriptors or memory, try again later
     };
 
     /** An error type that dealing with usual POSIX calling convention of using 0 for success and negative value for error, positive for count */
@@ -0,0 +1,274 @@
+#ifndef hpp_AssetCache_hpp
+#define hpp_AssetCache_hpp
+
+// We need the client and answers declaration
+#include "HTTP.hpp"
+// We need the monotonic clock
+#include "Container/TimerWheel.hpp"
+// We need TrackedBuffer
+#include "Container/TmpString.hpp"
+// We need stat
+#include <sys/stat.h>
+
+namespace Network::Servers::HTTP
+{
+    /** A cache for the static files (assets) that are served often.
+        The files are stored in a fixed size memory pool along with their status line and headers (Content-Type, Content-Length, ETag,
+        Last-Modified and Cache-Control) already serialized, so serving a cached file costs a lookup and a single gather send, without any
+        file access nor header formatting.
+        If served with the request's headers, the conditional headers are evaluated (with MaxSupport) and a revalidated file costs a 304
+        answer with the same headers and no content.
+        When the pool is full, the least recently used files are evicted. A file is reloaded when its modification time or size changes
+        (this is checked at most every CheckIntervalMs milliseconds to avoid a system call per request).
+        Files that don't fit in a quarter of the pool aren't cached, they are served with a FileAnswer instead, like the range requests.
+        A cached file sent to a slow client is parked in the pool, so the pool isn't modified while any answer is parked: a file that would
+        need to be loaded or reloaded meanwhile is served with a FileAnswer.
+
+        Usage is like this:
+        @code
+            static AssetCache<16, 65536> cache; // Large object, don't put it on the stack
+            constexpr auto index = [](Client & client, const auto & headers) { return cache.serve(client, "/www/index.html", headers); };
+        @endcode
+        @warning This isn't thread safe, use one cache per shard with a ShardedServer
+        @param MaxEntries       The maximum number of cached files
+        @param PoolSize         The size of the memory pool in bytes, storing the files' path, headers and content
+        @param CheckIntervalMs  The minimum time in milliseconds between two checks of a cached file's modification time */
+    template <std::size_t MaxEntries = 16, std::size_t PoolSize = 65536, uint32 CheckIntervalMs = 1000>
+    struct AssetCache
+    {
+        static_assert(MaxEntries < 65535, "Too many entries for this cache");
+        static constexpr uint16 None = 0xFFFF;
+        /** The maximum size of the serialized status line and headers */
+        static constexpr std::size_t MaxHeaderSize = 256;
+
+        /** A cached file. Its data is stored in the pool as: path, status line, headers, content */
+        struct Entry
+        {
+            /** The path's hash */
+            uint32  hash;
+            /** The position of the entry's data in the pool */
+            uint32  offset;
+            /** The length of the content */
+            uint32  contentLength;
+            /** The time of the last check of the file's modification time */
+            uint32  lastCheck;
+            /** The file's modification time */
+            time_t  modified;
+            uint16  pathLength;
+            /** The status line's length (including the final CRLF) */
+            uint16  statusLength;
+            /** The status line and headers' length */
+            uint16  headerLength;
+            /** The previous and next entry in the least recently used list */
+            uint16  prev, next;
+            /** Whether this entry is used */
+            bool    used;
+
+            uint32 getSize() const { return (uint32)pathLength + headerLength + contentLength; }
+        };
+
+        /** Serve the given file from the cache, loading it if required
+            @param client   The client to answer to
+            @param path     The path to the file
+            @return false upon error (the connection should be closed) */
+        bool serve(Client & client, const char * path) { return serve(client, path, nullptr); }
+
+        /** Serve the given file from the cache, or a 304 answer if the client's copy is still valid
+            @param client   The client to answer to
+            @param path     The path to the file
+            @param headers  The request's headers, with the conditional headers (see ConditionalHeaders) and the Range header, if any.
+                            A range request is served with a FileAnswer, since only whole files are cached
+            @return false upon error (the connection should be closed) */
+        template <typename H>
+        bool serve(Client & client, const char * path, const H & headers)
+        {
+            if constexpr (HasHeader<H, Headers::Range>)
+            {
+                if (headers.template getHeader<Headers::Range>().parsed.value) return client.sendAnswer(FileAnswer<Streams::FileInput>{path, headers, client.reqLine.method});
+            }
+            std::size_t pathLength = strlen(path);
+            uint16 i = find(path, pathLength);
+            if (i != None)
+            {
+                Entry & e = entries[i];
+                uint32 now = Container::getMonotonicTimeMs();
+                if (now - e.lastCheck >= CheckIntervalMs)
+                {   // Check if the file was modified since it was cached
+                    struct stat st;
+                    if (::stat(path, &st) != 0 || st.st_mtime != e.modified || (uint32)st.st_size != e.contentLength) { evict(i); i = None; }
+                    else e.lastCheck = now;
+                }
+            }
+            if (i == None && !parked) i = load(path, pathLength);
+            // Not found or too large to be cached, so let the usual file answer deal with it
+            if (i == None)
+            {
+                if constexpr (!std::is_same_v<H, std::nullptr_t> && requires { FileAnswer<Streams::FileInput>{path, headers, client.reqLine.method}; })
+                    return client.sendAnswer(FileAnswer<Streams::FileInput>{path, headers, client.reqLine.method});
+                else return client.sendAnswer(FileAnswer<Streams::FileInput>{path});
+            }
+
+            touch(i);
+            const Entry & e = entries[i];
+            const Code code = Validators(e.modified, e.contentLength).isNotModified(headers, client.reqLine.method) ? Code::NotModified : Code::Ok;
+            return client.sendPrebuilt((const char*)&pool[e.offset + e.pathLength], e.statusLength, e.headerLength, e.contentLength, code, &parked);
+        }
+
+        /** Remove the given file from the cache, if it's cached */
+        void invalidate(const char * path)
+        {
+            uint16 i = find(path, strlen(path));
+            if (i != None) evict(i);
+        }
+        /** Remove all the cached files */
+        void clear() { for (uint16 i = oldest, prev; i != None; i = prev) { prev = entries[i].prev; evict(i); } }
+
+        /** Build the cache
+            @param maxAge   The time in seconds the clients are allowed to cache the files (used for the Cache-Control header) */
+        AssetCache(const uint32 maxAge = 3600) : used(0), newest(None), oldest(None), maxAge(maxAge), parked(0)
+        {
+            for (auto & e : entries) e.used = false;
+        }
+
+    private:
+        Entry   entries[MaxEntries];
+        uint8   pool[PoolSize];
+        /** The used size in the pool (entries' data are packed at the beginning of the pool) */
+        uint32  used;
+        /** The most and least recently used entries */
+        uint16  newest, oldest;
+        uint32  maxAge;
+        /** The number of answers parked in the pool (see Client::sendPrebuilt) */
+        uint16  parked;
+
+        /** Find the entry for the given path */
+        uint16 find(const char * path, const std::size_t pathLength) const
+        {
+            uint32 hash = CompileTime::constHash(path, pathLength);
+            for (std::size_t i = 0; i < MaxEntries; i++)
+            {
+                const Entry & e = entries[i];
+                if (e.used && e.hash == hash && e.pathLength == pathLength && !memcmp(&pool[e.offset], path, pathLength)) return (uint16)i;
+            }
+            return None;
+        }
+        /** Remove the given entry from the least recently used list */
+        void unlink(const uint16 i)
+        {
+            Entry & e = entries[i];
+            if (e.prev != None) entries[e.prev].next = e.next; else newest = e.next;
+            if (e.next != None) entries[e.next].prev = e.prev; else oldest = e.prev;
+            e.prev = e.next = None;
+        }
+        /** Insert the given (unlinked) entry as the most recently used */
+        void link(const uint16 i)
+        {
+            Entry & e = entries[i];
+            e.prev = None;
+            e.next = newest;
+            if (newest != None) entries[newest].prev = i;
+            newest = i;
+            if (oldest == None) oldest = i;
+        }
+        /** Mark the given entry as the most recently used */
+        void touch(const uint16 i)
+        {
+            if (newest == i) return;
+            unlink(i);
+            link(i);
+        }
+        /** Evict the given entry and compact the pool.
+            If any answer is parked in the pool, it can't be compacted, so the entry is only marked to be reloaded */
+        void evict(const uint16 i)
+        {
+            Entry & e = entries[i];
+            if (parked)
+            {   // The next check will find the file modified
+                e.modified = (time_t)-1;
+                e.lastCheck = Container::getMonotonicTimeMs() - CheckIntervalMs;
+                return;
+            }
+            unlink(i);
+            uint32 size = e.getSize(), end = e.offset + size;
+            memmove(&pool[e.offset], &pool[end], used - end);
+            used -= size;
+            for (auto & o : entries)
+                if (o.used && o.offset >= end) o.offset -= size;
+            e.used = false;
+        }
+
+        /** Load the given file in the cache
+            @return the entry's index or None if it can't be cached */
+        uint16 load(const char * path, const std::size_t pathLength)
+        {
+            struct stat st;
+            if (::stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return None;
+
+            // Serialize the status line and headers first
+            uint8 headers[MaxHeaderSize];
+            Container::TrackedBuffer buffer(headers, sizeof(headers));
+            char number[sizeof("18446744073709551615")] = {};
+            const char * code = Refl::toString(Code::Ok);
+            ROString mime = Refl::toString(getMIMEFromExtension(ROString(path, (int)pathLength).fromLast(".")));
+            bool ok = buffer.save(HTTPAnswer, sizeof(HTTPAnswer) - 1) && buffer.save("200 ", 4) && buffer.save(code, strlen(code)) && buffer.save(EOM, 2);
+            std::size_t statusLength = buffer.used;
+            intToStr((int)st.st_size, number, 10);
+            ok = ok && saveHeader(buffer, Refl::toString(Headers::ContentType), mime.getData(), mime.getLength())
+                    && saveHeader(buffer, Refl::toString(Headers::ContentLength), number, strlen(number));
+            // The validators are the same as a FileAnswer's ones, so the client's copy stays valid if the file is evicted
+            const Validators validators(st.st_mtime, (std::size_t)st.st_size);
+            char date[DateLength + 1];
+            memcpy(number, "max-age=", 8);
+            intToStr((int)maxAge, number + 8, 10);
+            // ETag is only declared with MaxSupport, so use its name directly
+            ok = ok && saveHeader(buffer, "ETag", validators.etag, strlen(validators.etag))
+                    && saveHeader(buffer, Refl::toString(Headers::LastModified), date, formatDate(st.st_mtime, date))
+                    && saveHeader(buffer, Refl::toString(Headers::CacheControl), number, strlen(number))
+                    && buffer.save(EOM, 2);
+            if (!ok) return None;
+
+            // Then check if it fits
+            uint32 size = (uint32)(pathLength + buffer.used + (std::size_t)st.st_size);
+            if (size > PoolSize / 4) return None;
+
+            // Make room for it
+            uint16 i = None;
+            for (std::size_t j = 0; j < MaxEntries && i == None; j++)
+                if (!entries[j].used) i = (uint16)j;
+            while (oldest != None && (i == None || used + size > PoolSize))
+            {
+                if (i == None) i = oldest;
+                evict(oldest);
+            }
+
+            FILE * f = fopen(path, "rb");
+            if (!f) return None;
+            Entry & e = entries[i];
+            e.offset = used;
+            memcpy(&pool[e.offset], path, pathLength);
+            memcpy(&pool[e.offset + pathLength], headers, buffer.used);
+            std::size_t read = fread(&pool[e.offset + pathLength + buffer.used], 1, (std::size_t)st.st_size, f);
+            fclose(f);
+            if (read != (std::size_t)st.st_size) return None;
+
+            e.hash = CompileTime::constHash(path, pathLength);
+            e.contentLength = (uint32)st.st_size;
+            e.lastCheck = Container::getMonotonicTimeMs();
+            e.modified = st.st_mtime;
+            e.pathLength = (uint16)pathLength;
+            e.statusLength = (uint16)statusLength;
+            e.headerLength = (uint16)buffer.used;
+            e.used = true;
+            used += size;
+            link(i);
+            return i;
+        }
+        /** Save a header line in the given buffer */
+        static bool saveHeader(Container::TrackedBuffer & buffer, const char * name, const char * value, const std::size_t length)
+        {
+            return buffer.save(name, strlen(name)) && buffer.save(":", 1) && buffer.save(value, length) && buffer.save(EOM, 2);
+        }
+    };
+}
+
+#endif
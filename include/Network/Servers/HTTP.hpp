@@ -10,15 +10,21 @@
 #include "Strings/RWString.hpp"
 // We need error code too
 #include "Protocol/HTTP/Codes.hpp"
+// We need HTTP dates for the conditional requests
+#include "Protocol/HTTP/Dates.hpp"
 // We need compile time vectors here to cast some magical spells on types
 #include "Container/CTVector.hpp"
 #include "Container/RingBuffer.hpp"
 // We need streams too
 #include "Streams/Streams.hpp"
+// We need the compressing stream
+#include "Streams/Deflate.hpp"
 // We need forms too
 #include "Forms.hpp"
 
 #include <type_traits>
+// We need stat for finding compressed files
+#include <sys/stat.h>
 
 
 #ifndef ClientBufferSize
@@ -41,9 +47,343 @@ namespace Network::Servers::HTTP
     static constexpr const char EntityTooLargeAnswer[] = "HTTP/1.1 413 Entity too large\r\n\r\n";
     static constexpr const char InternalServerErrorAnswer[] = "HTTP/1.1 500 Internal server error\r\n\r\n";
     static constexpr const char NotFoundAnswer[] = "HTTP/1.1 404 Not found\r\n\r\n";
+    static constexpr const char UnavailableAnswer[] = "HTTP/1.1 503 Service unavailable\r\nConnection:close\r\n\r\n";
     static constexpr const char ChunkedEncoding[] = "Transfer-Encoding:chunked\r\n\r\n";
     static constexpr const char ConnectionClose[] = "Connection:close\r\n";
 
+    /** Format an unsigned number in the given base (up to 16). Unlike intToStr, it's not limited to 31 bits, so it's used for the file sizes and positions
+        @return the formatted length, the buffer is zero terminated */
+    inline std::size_t formatNumber(uint64 value, char * buffer, const uint32 base = 10)
+    {
+        char digits[64];
+        std::size_t n = 0;
+        do { digits[n++] = "0123456789abcdef"[value % base]; value /= base; } while (value);
+        for (std::size_t i = 0; i < n; i++) buffer[i] = digits[n - 1 - i];
+        buffer[n] = 0;
+        return n;
+    }
+
+    /** The byte ranges requested with a Range header (RFC9110 14.2), resolved for a content of a known size.
+        A single range is sent as is, multiple ranges are sent as a multipart/byteranges content */
+    struct ByteRanges
+    {
+        /** The maximum number of ranges in a request, the whole content is sent for a request with more ranges */
+        static constexpr std::size_t MaxRanges = 4;
+        /** The boundary between the parts of a multiple ranges answer */
+        static constexpr const char Boundary[] = "eHTTPdByteRanges";
+        /** The maximum size of a part's header */
+        static constexpr std::size_t MaxPartHeaderSize = 192;
+
+        /** A range, the positions are inclusive */
+        struct Range
+        {
+            std::size_t first, last;
+            std::size_t getLength() const { return last - first + 1; }
+        };
+        Range       ranges[MaxRanges];
+        /** The number of satisfiable ranges, 0 if none can be satisfied */
+        uint8       count = 0;
+        /** The content's complete length */
+        std::size_t size = 0;
+        /** The MIME type of the parts, for a multiple ranges answer */
+        ROString    type;
+
+        /** Parse the ranges from the Range header's value (like "bytes=0-99,-500"), for a content of the given size.
+            Ranges starting after the end of the content are ignored, the others are clamped to the content's size.
+            @return false if the header is invalid or isn't supported, the whole content should be sent in that case */
+        bool parse(const ROString & value, const std::size_t size)
+        {
+            static constexpr const char Unit[] = "bytes=";
+            const char * p = value.getData(), * e = p + value.getLength();
+            this->size = size; count = 0;
+            if (value.getLength() < sizeof(Unit) - 1 || memcmp(p, Unit, sizeof(Unit) - 1)) return false;
+            p += sizeof(Unit) - 1;
+            while (p < e)
+            {
+                while (p < e && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+                if (p == e) break;
+                std::size_t first = 0, last = 0;
+                bool hasFirst = parseNumber(p, e, first);
+                if (p == e || *p++ != '-') return false;
+                bool hasLast = parseNumber(p, e, last);
+                while (p < e && (*p == ' ' || *p == '\t')) p++;
+                if (p < e && *p != ',') return false;
+                if (!hasFirst && !hasLast) return false;
+                if (hasFirst && hasLast && last < first) return false;
+
+                if (!hasFirst)
+                {   // Suffix range, the last bytes of the content
+                    if (!last || !size) continue;
+                    first = last >= size ? 0 : size - last;
+                    last = size - 1;
+                }
+                else if (first >= size) continue;
+                else if (!hasLast || last >= size) last = size - 1;
+
+                if (count == MaxRanges) return false;
+                ranges[count++] = Range{first, last};
+            }
+            return true;
+        }
+
+        /** Format the Content-Range header's value for the given range (or for an unsatisfiable request if index is count)
+            @return the formatted length */
+        std::size_t formatContentRange(char * buffer, const std::size_t index) const
+        {
+            std::size_t l = sizeof("bytes ") - 1;
+            memcpy(buffer, "bytes ", l);
+            if (index < count)
+            {
+                l += formatNumber(ranges[index].first, buffer + l);
+                buffer[l++] = '-';
+                l += formatNumber(ranges[index].last, buffer + l);
+            }
+            else buffer[l++] = '*';
+            buffer[l++] = '/';
+            return l + formatNumber(size, buffer + l);
+        }
+        /** Format the header of the given part of a multiple ranges answer (with the previous part's delimiter)
+            @return the formatted length */
+        std::size_t formatPartHeader(char * buffer, const std::size_t index) const
+        {
+            std::size_t l = 0;
+            auto append = [&](const char * s, const std::size_t n) { memcpy(buffer + l, s, n); l += n; };
+            append("\r\n--", 4);
+            append(Boundary, sizeof(Boundary) - 1);
+            append("\r\nContent-Type:", 15);
+            append(type.getData(), min((std::size_t)type.getLength(), MaxPartHeaderSize / 2));
+            append("\r\nContent-Range:", 16);
+            l += formatContentRange(buffer + l, index);
+            append(EOM, 4);
+            return l;
+        }
+        /** The length of the final delimiter of a multiple ranges answer */
+        static constexpr std::size_t getCloseDelimiterLength() { return sizeof("\r\n--") - 1 + sizeof(Boundary) - 1 + sizeof("--\r\n") - 1; }
+
+    private:
+        static bool parseNumber(const char *& p, const char * e, std::size_t & value)
+        {
+            const char * s = p;
+            for (value = 0; p < e && *p >= '0' && *p <= '9'; p++)
+                value = value > (SIZE_MAX - 9) / 10 ? SIZE_MAX : value * 10 + (std::size_t)(*p - '0');
+            return p != s;
+        }
+    };
+
+    /** The request's headers that make an answer conditional. They are only parsed with MaxSupport */
+    template <typename H>
+    concept ConditionalHeaders =
+#if MaxSupport == 1
+        HasHeader<H, Headers::IfNoneMatch> || HasHeader<H, Headers::IfModifiedSince>;
+#else
+        false;
+#endif
+
+    /** The validators of a representation (RFC9110 8.8): its entity tag and its modification time.
+        For a file, the entity tag is a strong one built from its modification time and size (like most servers do), so it costs a stat and
+        no content hashing.
+        They are used to answer a conditional request with a header only 304 Not Modified answer when the client's copy is still valid */
+    struct Validators
+    {
+        /** The entity tag, with its quotes (empty if unknown) */
+        char    etag[sizeof("\"ffffffffffffffff-ffffffffffffffff\"")] = {};
+        /** The modification time, -1 if unknown */
+        time_t  modified = -1;
+
+        /** Check if the validators are known */
+        bool isValid() const { return etag[0] != 0; }
+        ROString getETag() const { return ROString(etag, (int)strlen(etag)); }
+
+        /** Check if the client's copy of the representation is still valid, so a 304 Not Modified answer can be sent instead.
+            If-None-Match takes precedence over If-Modified-Since (RFC9110 13.2.2), and both are ignored without MaxSupport since they aren't parsed
+            @param method   The request's method, If-Modified-Since is ignored unless it's GET or HEAD (RFC9110 13.1.3) */
+        template <typename H>
+        bool isNotModified(const H & headers, const Method method) const
+        {
+#if MaxSupport == 1
+            if constexpr (HasHeader<H, Headers::IfNoneMatch>)
+            {
+                const ROString & tags = headers.template getHeader<Headers::IfNoneMatch>().parsed.value;
+                if (tags) return isValid() && matchAny(tags);
+            }
+            if constexpr (HasHeader<H, Headers::IfModifiedSince>)
+            {
+                if (method != Method::GET && method != Method::HEAD) return false;
+                const ROString & since = headers.template getHeader<Headers::IfModifiedSince>().parsed.value;
+                time_t date;
+                if (since && modified != -1 && parseDate(since, date)) return modified <= date;
+            }
+#endif
+            return false;
+        }
+        /** Check if the Range header should be honored: it's ignored if the If-Range header doesn't match the representation (strong comparison).
+            A date only matches a strong Last-Modified, that is one at least a second older than now (RFC9110 8.8.2.2), since the file could
+            have been modified twice in the same second */
+        template <typename H>
+        bool isRangeValid(const H & headers) const
+        {
+#if MaxSupport == 1
+            if constexpr (HasHeader<H, Headers::IfRange>)
+            {
+                const ROString & cond = headers.template getHeader<Headers::IfRange>().parsed.value;
+                if (!cond) return true;
+                if (cond[0] == '"') return isValid() && cond == getETag();
+                time_t date;
+                // Weak entity tags never match (and a date can start with a W too)
+                return cond.midString(0, 2) != "W/" && modified != -1 && parseDate(cond, date) && date == modified && modified < time(nullptr);
+            }
+#endif
+            return true;
+        }
+
+        /** Send the ETag and Last-Modified headers */
+        bool send(Socket & socket) const
+        {
+            if (!isValid()) return true;
+            char date[DateLength + 1];
+            // ETag is only declared with MaxSupport, so use its name directly
+            socket.send("ETag:", 5);
+            socket.send(etag, strlen(etag));
+            socket.send(EOM, 2);
+            if (modified == -1 || !formatDate(modified, date)) return true;
+            socket.send(Refl::toString(Headers::LastModified), strlen(Refl::toString(Headers::LastModified)));
+            socket.send(":", 1);
+            socket.send(date, DateLength);
+            return !socket.send(EOM, 2).isError();
+        }
+
+        Validators() {}
+        /** Build the validators of a file from its modification time and size */
+        Validators(const time_t modified, const std::size_t size) : modified(modified)
+        {
+            etag[0] = '"';
+            std::size_t l = 1 + formatNumber((uint64)modified, etag + 1, 16);
+            etag[l++] = '-';
+            l += formatNumber(size, etag + l, 16);
+            etag[l++] = '"';
+            etag[l] = 0;
+        }
+        /** Build the validators of the given file, they are unknown if it isn't found */
+        explicit Validators(const char * path)
+        {
+            struct stat st;
+            if (::stat(path, &st) == 0 && S_ISREG(st.st_mode)) *this = Validators(st.st_mtime, (std::size_t)st.st_size);
+        }
+        /** Build the validators from a known entity tag (with its quotes), for a content without modification time */
+        explicit Validators(const ROString & tag)
+        {
+            if (tag.getLength() < 2 || (std::size_t)tag.getLength() >= sizeof(etag)) return;
+            memcpy(etag, tag.getData(), (std::size_t)tag.getLength());
+            etag[tag.getLength()] = 0;
+        }
+
+    private:
+        /** Check if the given entity tags list (from a If-None-Match header) contains ours, with the weak comparison */
+        bool matchAny(const ROString & tags) const
+        {
+            const char * p = tags.getData(), * e = p + tags.getLength();
+            const std::size_t length = strlen(etag);
+            while (p < e)
+            {
+                while (p < e && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+                if (p < e && *p == '*') return true;
+                if (e - p >= 2 && p[0] == 'W' && p[1] == '/') p += 2;
+                const char * s = p;
+                while (p < e && *p != ',') p++;
+                const char * t = p;
+                while (t > s && (t[-1] == ' ' || t[-1] == '\t')) t--;
+                if ((std::size_t)(t - s) == length && !memcmp(s, etag, length)) return true;
+            }
+            return false;
+        }
+    };
+
+    /** The headers sent with every answer: Date and Server.
+        They are preformatted in a single block, refreshed at most once per second by the server's loop, so an answer only copies them
+        instead of formatting a date. Each server has its own, so the shards of a ShardedServer don't share it */
+    struct CommonHeaders
+    {
+        /** The earliest time that's considered valid, before that the system clock isn't set and no Date header is sent (RFC9110 6.6.1) */
+        static constexpr time_t MinValidTime = 1577836800; // 2020-01-01
+
+        char    block[sizeof("Date:\r\nServer:\r\n") + DateLength + sizeof(ServerName)];
+        uint16  length = 0;
+        /** The time the block was formatted for */
+        time_t  formatted = 0;
+
+        /** Refresh the headers for the given time, this only formats the date if the second changed */
+        void refresh(const time_t now)
+        {
+            if (now == formatted && length) return;
+            formatted = now;
+            std::size_t l = 0;
+#if SendDateHeader == 1
+            if (now >= MinValidTime)
+            {
+                memcpy(block, "Date:", 5);
+                l = 5 + formatDate(now, block + 5);
+                memcpy(block + l, EOM, 2);
+                l += 2;
+            }
+#endif
+            if (sizeof(ServerName) > 1)
+            {
+                memcpy(block + l, "Server:", 7);
+                memcpy(block + l + 7, ServerName, sizeof(ServerName) - 1);
+                l += 7 + sizeof(ServerName) - 1;
+                memcpy(block + l, EOM, 2);
+                l += 2;
+            }
+            length = (uint16)l;
+        }
+        ROString get() const { return ROString(block, length); }
+    };
+
+    /** A resumable scanner for the line endings of a request.
+        A request received in many small parts isn't scanned again from its beginning each time a part is received: the scan's state is kept
+        between the parts, so each byte is inspected once. The offsets are relative to the receive buffer's head, so they must be adjusted
+        when the beginning of the buffer is dropped */
+    struct RequestScanner
+    {
+        /** The count of bytes already scanned */
+        uint32  offset = 0;
+        /** The offset right after the last line ending found */
+        uint32  lineEnd = 0;
+        /** The count of bytes of the end of headers ("\r\n\r\n") matching the last scanned bytes */
+        uint8   matched = 0;
+
+        /** Scan the bytes received since the last call
+            @param buffer   The received bytes, starting at the receive buffer's head
+            @param target   The count of bytes of "\r\n\r\n" to find: 2 for the end of the request line, 4 for the end of the headers
+            @return true if found */
+        bool scan(const ROString & buffer, const uint8 target)
+        {
+            if (matched >= target) return true;
+            const char * p = buffer.getData();
+            for (const uint32 length = (uint32)buffer.getLength(); offset < length;)
+            {
+                // Skip to the next CR, many bytes at a time
+                if (!matched && (offset += (uint32)Scan::find<'\r'>(p + offset, length - offset)) == length) break;
+                const char c = p[offset++];
+                matched = c == EOM[matched] ? (uint8)(matched + 1) : (uint8)(c == '\r');
+                if (matched == 2 || matched == 4) lineEnd = offset;
+                if (matched >= target) return true;
+            }
+            return false;
+        }
+        /** Check if a complete line starts at the given offset */
+        bool hasLine(const std::size_t from) const { return from < lineEnd; }
+        /** Restart the scan at the buffer's head
+            @param state    The count of bytes of "\r\n\r\n" matched before the head, 2 if the head is at the beginning of a line */
+        void reset(const uint8 state = 0) { offset = lineEnd = 0; matched = state; }
+        /** Adjust the offsets after the given count of bytes was dropped from the beginning of the receive buffer */
+        void dropped(const std::size_t size)
+        {
+            offset = offset > size ? offset - (uint32)size : 0;
+            lineEnd = lineEnd > size ? lineEnd - (uint32)size : 0;
+        }
+    };
+
     /** The current client parsing state */
     enum class ClientState
     {
@@ -76,6 +416,7 @@ namespace Network::Servers::HTTP
             NeedRefillHeaders, // Currently not implemented, used to trigger route's processing for emptying the recv buffer in case the request doesn't fill the available buffer
             HeadersDone,
             ReqDone,
+            SendingAnswer, // The answer is being sent asynchronously, the socket is monitored for writing
 
         } parsingStatus;
 
@@ -83,27 +424,97 @@ namespace Network::Servers::HTTP
         Container::TranscientVault<ClientBufferSize> recvBuffer;
         /** The current request as received and parsed by the server */
         RequestLine reqLine;
+        /** Where the search for the end of the request line and headers stopped in the receive buffer */
+        RequestScanner scanner;
+        /** The parameters captured by the route's pattern, as views on the requested path (see getCapture) */
+        ROString    captures[MaxRouteCaptures];
+        uint8       captureCount = 0;
         /** Whether to close or keep the connection open after this request.
-            When a connection is kept open, each loop without activity will decrease the TTL until it reaches 0 and force the client connection to close */
-        uint8       timeToLive = 0;
+            When a connection is kept open, the server closes it if no request is received in KeepAliveTimeoutMs */
+        bool        keepAlive = false;
+
+        /** The headers to send with every answer, they are owned by the server */
+        const CommonHeaders * commonHeaders = nullptr;
 
         /** The content length for the answer */
         std::size_t answerLength;
         Code        replyCode;
+        /** The answer's stream that's waiting for the socket to be writable again.
+            File based streams and contents that outlive the answer (like a prebuilt answer) are parked, the data that wasn't sent yet is stored in
+            the receive buffer. A chunked content isn't parked since its callback usually refers to the route's stack */
+        Streams::ParkedInput pendingStream;
+
+        /** Get the given stream's mapping and its current position, if it can be mapped */
+        template <typename S>
+        static const uint8 * getMapping(S & stream, std::size_t & pos)
+        {
+            if constexpr (requires { stream.map(); stream.getPos(); })
+            {
+                pos = stream.getPos();
+                return (const uint8 *)stream.map();
+            }
+            else return nullptr;
+        }
+
+        /** Send the given content from memory without blocking on a slow client. If the socket's buffer is full, the remaining content is parked
+            and the server resumes sending it later on (check hasPendingOutput)
+            @param persistent   If true, the content stays valid until the parked stream is released, so it's parked where it is. Else, it's
+                                copied to the receive buffer if it fits there, or sent blocking if it doesn't
+            @param pin          See ParkedInput::take
+            @return false upon error */
+        bool sendFromMemory(const uint8 * data, std::size_t pos, const std::size_t end, const bool persistent, uint16 * pin = nullptr)
+        {
+            while (pos < end)
+            {
+                Error ret = socket.sendNonBlocking((const char*)data + pos, (uint32)(end - pos));
+                if (ret == WouldBlock)
+                {
+                    if (persistent)
+                    {
+                        if (pendingStream.memory == data) pendingStream.offset = (off_t)pos;
+                        else pendingStream.take(data, (off_t)pos, end, pin);
+                        parsingStatus = SendingAnswer;
+                        return true;
+                    }
+                    if (end - pos <= recvBuffer.freeSize())
+                    {
+                        memcpy(recvBuffer.getTail(), data + pos, end - pos);
+                        recvBuffer.stored((uint32)(end - pos));
+                        parsingStatus = SendingAnswer;
+                        return true;
+                    }
+                    // The content might be gone once the answer is returned and it doesn't fit in the buffer, so wait for the socket
+                    ret = socket.send((const char*)data + pos, (uint32)(end - pos));
+                    if (!ret.isError() && !ret.getCount()) return false;
+                }
+                if (ret.isError()) return false;
+                pos += (std::size_t)ret.getCount();
+            }
+            return true;
+        }
+
+        /** Send a static answer, it's already serialized (see StaticAnswer) */
+        template <typename T> requires requires { std::decay_t<T>::serialized; }
+        bool sendAnswer(T &&) { return std::decay_t<T>::send(*this); }
 
         /** Send the client answer as expected */
         template <typename T>
         bool sendAnswer(T && clientAnswer) {
-            if (!sendStatus(clientAnswer.getCode())) return false;
-
             // We'll be loosing the URI content when we clear the recvBuffer for sending data back, so store the
             // request URI on the stack for logging purpose below
             char * URI = (char*)alloca(reqLine.URI.absolutePath.getLength());
             memcpy(URI, reqLine.URI.absolutePath.getData(), reqLine.URI.absolutePath.getLength());
 
-            recvBuffer.reset();
+            // If the client pipelined its requests, the next request might already be in the buffer, so keep it
+            // This isn't done for requests with a body since it's not known here if the route has consumed it
+            if (reqLine.method < Method::POST && recvBuffer.getSize()) stashPipelined();
+            else if (!pipelinedSize) recvBuffer.reset();
+
+            // Coalesce the status line, the headers and the beginning of the content in the receive buffer, so they are sent with a single system call
+            Network::SendBatch batch(socket, recvBuffer.getTail(), recvBuffer.freeSize());
+            if (!sendStatus(clientAnswer.getCode())) return false;
             // Force closing the connection if required or asked, we don't send the Connection:keep-alive header since it's the default in HTTP/1.1
-            if (!timeToLive)
+            if (!keepAlive)
                 socket.send(ConnectionClose, sizeof(ConnectionClose) - 1);
 
             if (!clientAnswer.sendHeaders(*this)) return false;
@@ -112,20 +523,83 @@ namespace Network::Servers::HTTP
             if constexpr (!std::is_same_v<std::decay_t<decltype(stream)>, std::nullptr_t>)
             {
                 answerLength = stream.getSize();
+                if constexpr (requires { clientAnswer.getRanges(); })
+                {   // Only send the requested range of the content, multiple ranges (or none if they can't be satisfied) need a specific answer
+                    const ByteRanges * ranges = clientAnswer.getRanges();
+                    if (ranges && ranges->count != 1) return sendRanges(stream, *ranges, batch, URI, clientAnswer.getCode());
+                    if (ranges)
+                    {
+                        if (!stream.setPos(ranges->ranges[0].first)) return false;
+                        answerLength = ranges->ranges[0].getLength();
+                    }
+                }
                 if (answerLength)
                 {
                     if (!sendSize(answerLength))
                     {
-                        SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, 523, !timeToLive ? " closed" : "");
+                        SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, 523, !keepAlive ? " closed" : "");
                         return false;
                     }
 
+                    // Send the first part of the content with the headers
+                    std::size_t left = answerLength, pos = 0;
+                    if (reqLine.method != Method::HEAD)
+                    {
+                        std::size_t p = stream.read(batch.getTail(), min((std::size_t)batch.freeSize(), left));
+                        socket.send((const char*)batch.getTail(), (uint32)p);
+                        left -= p;
+                    }
+                    if (batch.done().isError()) return false;
+
+#if LinuxHost == 1 && UseTLSServer == 0
+                    if constexpr (requires { stream.getFileDescriptor(); pendingStream.take(stream, 0); })
+                    {   // Let the kernel send the file directly, from where the stream stopped (zero copy)
+                        off_t offset = (off_t)stream.getPos();
+                        const std::size_t end = (std::size_t)offset + left;
+                        Error ret = reqLine.method == Method::HEAD ? Error(Success) : socket.sendFile(stream.getFileDescriptor(), offset, left);
+                        if (ret == WouldBlock)
+                        {   // Park the stream and let the server resume sending later on
+                            pendingStream.take(stream, offset, end);
+                            parsingStatus = SendingAnswer;
+                            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, (int)clientAnswer.getCode(), " pending");
+                            return true;
+                        }
+                        if (ret.isError()) return false;
+                    }
+                    else
+#endif
+                    if (const uint8 * data = reqLine.method != Method::HEAD ? getMapping(stream, pos) : nullptr)
+                    {   // Send the remaining content directly from the stream's mapping, without copying it to the receive buffer
+                        if constexpr (requires { pendingStream.take(stream, 0); })
+                            // Take over the stream's mapping, so it stays valid if the content is parked
+                            pendingStream.take(stream, (off_t)pos, pos + left);
+                        if (!sendFromMemory(data, pos, pos + left, pendingStream.memory == data)) return false;
+                        if (hasPendingOutput())
+                        {
+                            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, (int)clientAnswer.getCode(), " pending");
+                            return true;
+                        }
+                    }
                     // Send the content now
-                    while (reqLine.method != Method::HEAD)
+                    else while (reqLine.method != Method::HEAD && left)
                     {
-                        std::size_t p = stream.read(recvBuffer.getTail(), recvBuffer.freeSize());
+                        std::size_t p = stream.read(recvBuffer.getTail(), min(recvBuffer.freeSize(), left));
                         if (!p) break;
+                        left -= p;
+                        if constexpr (requires { pendingStream.take(stream); })
+                        {   // Don't block on a slow client, if the socket's buffer is full, park the stream and let the server resume sending later on
+                            Error ret = socket.sendNonBlocking((const char*)recvBuffer.getTail(), p);
+                            if (ret.isError() && ret != WouldBlock) return false;
+                            std::size_t sent = (std::size_t)ret.getCount();
+                            if (sent == p) continue;
 
+                            recvBuffer.stored(p);
+                            recvBuffer.drop(sent);
+                            pendingStream.take(stream, -1, stream.getPos() + left);
+                            parsingStatus = SendingAnswer;
+                            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, (int)clientAnswer.getCode(), " pending");
+                            return true;
+                        }
                         socket.send((const char*)recvBuffer.getTail(), p);
                     }
 
@@ -135,30 +609,100 @@ namespace Network::Servers::HTTP
                         // Need to send a transfer encoding header if we don't have a size for the content and it's not done by the client's answer by itself
                         socket.send(ChunkedEncoding, sizeof(ChunkedEncoding) - 1);
                     }
+                    // Send the headers now, the content might be produced slowly
+                    if (batch.done().isError()) return false;
 
                     if (!clientAnswer.sendContent(*this, answerLength))
                     {
-                        SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, 0U, 524, !timeToLive ? " closed" : "");
+                        SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, 0U, 524, !keepAlive ? " closed" : "");
                         return false;
                     }
                 } else if (!stream.hasContent())
                 {
-                    if (!sendSize(0))
+                    if (!sendNoContent(clientAnswer.getCode()))
                     {
-                        SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, 525, !timeToLive ? " closed" : "");
+                        SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, 525, !keepAlive ? " closed" : "");
                         return false;
                     }
                 }
             } else
             {
-                if (!sendSize(0))
+                if (!sendNoContent(clientAnswer.getCode()))
                 {
-                    SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, 525, !timeToLive ? " closed" : "");
+                    SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, 525, !keepAlive ? " closed" : "");
                     return false;
                 }
             }
 
-            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, (int)clientAnswer.getCode(), !timeToLive ? " closed" : "");
+            if (batch.done().isError()) return false;
+            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, answerLength, (int)clientAnswer.getCode(), !keepAlive ? " closed" : "");
+            parsingStatus = ReqDone;
+            reset();
+            return true;
+        }
+
+        /** Send an answer that's already serialized (status line, headers and content are contiguous in memory), like a cached asset.
+            This is sent with a single gather system call, the Connection:close header (if required) and the common headers being inserted after the status line
+            @param answer           The serialized answer
+            @param statusLength     The status line's length (including the final CRLF)
+            @param headerLength     The status line and headers' length (including the final empty line)
+            @param contentLength    The content's length, following the headers
+            @param code             The answer's code (for logging). If it's Code::NotModified, the headers are sent with a 304 status line and
+                                    without the content (their Content-Length is the one of the representation, as expected for a 304 answer)
+            @param pin              The answer must stay valid until it's sent. If the answer can be modified by its owner (like a cache), this
+                                    counter is incremented while the answer is parked (see ParkedInput::take) */
+        bool sendPrebuilt(const char * answer, const std::size_t statusLength, const std::size_t headerLength, const std::size_t contentLength, Code code, uint16 * pin = nullptr)
+        {
+            static constexpr const char NotModifiedStatus[] = "HTTP/1.1 304 Not Modified\r\n";
+            char * URI = (char*)alloca(reqLine.URI.absolutePath.getLength());
+            memcpy(URI, reqLine.URI.absolutePath.getData(), reqLine.URI.absolutePath.getLength());
+            // Keep the pipelined requests, if any (see sendAnswer)
+            if (reqLine.method < Method::POST && recvBuffer.getSize()) stashPipelined();
+            else if (!pipelinedSize) recvBuffer.reset();
+
+            const bool notModified = code == Code::NotModified;
+            const std::size_t content = reqLine.method != Method::HEAD && !notModified ? contentLength : 0;
+            struct iovec vec[4] = { notModified ? iovec{ (void*)NotModifiedStatus, sizeof(NotModifiedStatus) - 1 } : iovec{ (void*)answer, statusLength },
+                                    { (void*)ConnectionClose, keepAlive ? 0 : sizeof(ConnectionClose) - 1 },
+                                    { commonHeaders ? (void*)commonHeaders->block : nullptr, commonHeaders ? commonHeaders->length : 0U },
+                                    { (void*)(answer + statusLength), headerLength - statusLength + content } };
+            const uint8 * contentData = (const uint8*)answer + headerLength;
+#if UseTLSServer == 0
+            // Send as much as possible without blocking on a slow client
+            Error ret = socket.sendvNonBlocking(vec, 4);
+            bool ok = !ret.isError() || ret == WouldBlock;
+            std::size_t sent = (std::size_t)ret.getCount();
+            if (ok && sent < vec[0].iov_len + vec[1].iov_len + vec[2].iov_len + vec[3].iov_len)
+            {   // The socket's buffer is full, so the status line and headers that weren't sent are copied to the receive buffer (they are small)
+                // and the content is parked where it is
+                vec[3].iov_len = headerLength - statusLength;
+                for (struct iovec & v : vec)
+                {
+                    const std::size_t skip = min(sent, v.iov_len);
+                    sent -= skip;
+                    if (v.iov_len - skip > recvBuffer.freeSize()) { ok = false; break; }
+                    memcpy(recvBuffer.getTail(), (const uint8*)v.iov_base + skip, v.iov_len - skip);
+                    recvBuffer.stored((uint32)(v.iov_len - skip));
+                }
+                pendingStream.take(contentData, (off_t)sent, content, pin);
+                parsingStatus = SendingAnswer;
+            }
+#else
+            // There's no scatter-gather in TLS, so send the status line and headers first, then the content without blocking on a slow client
+            vec[3].iov_len = headerLength - statusLength;
+            bool ok = !socket.sendv(vec, 4).isError() && sendFromMemory(contentData, 0, content, true, pin);
+#endif
+            if (!ok)
+            {
+                SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, (unsigned)contentLength, 523, !keepAlive ? " closed" : "");
+                return false;
+            }
+            if (hasPendingOutput())
+            {
+                SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, (unsigned)contentLength, (int)code, " pending");
+                return true;
+            }
+            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, (unsigned)contentLength, (int)code, !keepAlive ? " closed" : "");
             parsingStatus = ReqDone;
             reset();
             return true;
@@ -174,17 +718,72 @@ namespace Network::Servers::HTTP
             socket.send(buffer, strlen(buffer));
             socket.send(Refl::toString(replyCode), strlen(Refl::toString(replyCode)));
             socket.send(EOM, 2);
+            if (commonHeaders) socket.send(commonHeaders->block, commonHeaders->length);
             return true;
         }
         bool sendSize(std::size_t length) { return Common::HTTP::sendSize(socket, length); }
+        /** End the headers of an answer without content. A 304 answer has no content but its Content-Length would be the one of the representation, so it's not sent */
+        bool sendNoContent(const Code code) { return code == Code::NotModified ? !socket.send(EOM, 2).isError() : sendSize(0); }
+        /** Send the parts of a stream for a multiple ranges request (as a multipart/byteranges content), or no content if the ranges can't be satisfied */
+        template <typename S>
+        bool sendRanges(S & stream, const ByteRanges & ranges, Network::SendBatch & batch, const char * URI, const Code code)
+        {
+            char part[ByteRanges::MaxPartHeaderSize];
+            std::size_t length = 0;
+            if (ranges.count)
+            {
+                for (std::size_t i = 0; i < ranges.count; i++) length += ranges.formatPartHeader(part, i) + ranges.ranges[i].getLength();
+                length += ByteRanges::getCloseDelimiterLength();
+            }
+            if (!sendSize(length)) return false;
+            for (std::size_t i = 0; i < ranges.count && reqLine.method != Method::HEAD; i++)
+            {
+                socket.send(part, (uint32)ranges.formatPartHeader(part, i));
+                if (!stream.setPos(ranges.ranges[i].first)) return false;
+                // Read the part in the batch's buffer directly, it's sent when full
+                std::size_t left = ranges.ranges[i].getLength();
+                while (left)
+                {
+                    if (!batch.freeSize() && batch.flush().isError()) return false;
+                    std::size_t p = stream.read(batch.getTail(), min((std::size_t)batch.freeSize(), left));
+                    if (!p) return false;
+                    if (socket.send((const char*)batch.getTail(), (uint32)p).isError()) return false;
+                    left -= p;
+                }
+            }
+            if (ranges.count && reqLine.method != Method::HEAD)
+            {
+                socket.send("\r\n--", 4);
+                socket.send(ByteRanges::Boundary, sizeof(ByteRanges::Boundary) - 1);
+                socket.send("--\r\n", 4);
+            }
+            if (batch.done().isError()) return false;
+            SLog(Level::Info, "Client %s [%.*s](%u): %d%s", socket.address, (int)reqLine.URI.absolutePath.getLength(), URI, length, (int)code, !keepAlive ? " closed" : "");
+            parsingStatus = ReqDone;
+            reset();
+            return true;
+        }
+
         bool reply(Code statusCode, const ROString & msg, bool close = false);
         bool reply(Code statusCode);
 
         bool closeWithError(Code code) { forceCloseConnection(); return reply(code); }
-        void forceCloseConnection() { timeToLive = 0; }
+        void forceCloseConnection() { keepAlive = false; }
 
 
         uint32 persistVaultSize = 0;
+        /** The size of the next pipelined request's data that was received with the current request, and the vault's size once it was stashed */
+        uint32 pipelinedSize = 0, pipelinedVault = 0;
+        /** Keep the pipelined request's data (following the given position in the receive buffer) aside until the answer is sent */
+        void stashPipelined(const uint32 from = 0) { pipelinedSize = recvBuffer.stashTranscient(from); pipelinedVault = recvBuffer.vaultSize(); }
+        /** The request's headers were parsed up to the given position in the receive buffer, so drop them.
+            For a request without content, the remaining data is the next pipelined request. It's stashed instead of being moved to the
+            beginning of the buffer, so the parsed headers' values stay valid for the route */
+        void headersParsed(const uint32 size)
+        {
+            if (reqLine.method < Method::POST && recvBuffer.getSize() > size) stashPipelined(size);
+            else recvBuffer.drop(size);
+        }
         inline bool hasPersistedHeaders() const { return recvBuffer.vaultSize() > persistVaultSize; }
 
         template <typename Headers>
@@ -271,18 +870,19 @@ namespace Network::Servers::HTTP
         }
 
         bool parse() {
-            timeToLive = 255;
+            keepAlive = true;
             ROString buffer = recvBuffer.getView<ROString>();
             switch (parsingStatus)
             {
             case Invalid:
             {   // Check if we had a complete request line
                 parsingStatus = ReqLine;
+                scanner.reset();
             }
             [[fallthrough]];
             case ReqLine:
             {
-                if (buffer.Find("\r\n") != buffer.getLength())
+                if (scanner.scan(buffer, 2))
                 {
                     // Potential request line found, let's parse it to check if it's full
                     if (ParsingError err = reqLine.parse(buffer); err != MoreData)
@@ -299,6 +899,8 @@ namespace Network::Servers::HTTP
                     // We don't need the request line anymore, let's drop it from the receive buffer
                     persistVaultSize = recvBuffer.vaultSize();
                     buffer = recvBuffer.getView<ROString>();
+                    // The headers start right after the request line's ending, so an empty line here ends them
+                    scanner.reset(2);
                 } else {
                     // Check if we can ultimately receive a valid request?
                     return recvBuffer.freeSize() ? true : closeWithError(Code::EntityTooLarge);
@@ -307,7 +909,7 @@ namespace Network::Servers::HTTP
             [[fallthrough]];
             case RecvHeaders:
             case NeedRefillHeaders:
-                if (buffer.Find(EOM) != buffer.getLength() || buffer == "\r\n") // No header here is valid too
+                if (scanner.scan(buffer, 4)) // No header here is valid too
                 {
                     parsingStatus = HeadersDone;
                     return true;
@@ -324,40 +926,83 @@ namespace Network::Servers::HTTP
                     return true;
                 }
             case HeadersDone:
-            case ReqDone: break;
+            case ReqDone:
+            case SendingAnswer: break;
+            }
+            return true;
+        }
+        /** Check if an answer is being sent asynchronously */
+        bool hasPendingOutput() const { return parsingStatus == SendingAnswer; }
+        /** Continue sending the pending answer. This is called by the server when the socket is writable again
+            @return false upon error (the connection should be closed), true otherwise, check hasPendingOutput() to know if it's done */
+        bool resumeSending()
+        {
+            // Send the data stored in the receive buffer first, refilling it from the stream if it's read
+            while (true)
+            {
+                if (!recvBuffer.getSize())
+                {
+                    if (pendingStream.memory || pendingStream.offset >= 0) break;
+                    std::size_t p = pendingStream.read(recvBuffer.getTail(), recvBuffer.freeSize());
+                    if (!p) break;
+                    recvBuffer.stored(p);
+                }
+                Error ret = socket.sendNonBlocking((const char*)recvBuffer.getHead(), recvBuffer.getSize());
+                if (ret == WouldBlock) return true;
+                if (ret.isError()) return false;
+                recvBuffer.drop(ret.getCount());
+            }
+            if (pendingStream.memory)
+            {   // Content sent from memory directly (like a mapping or a prebuilt answer)
+                while ((std::size_t)pendingStream.offset < pendingStream.end)
+                {
+                    Error ret = socket.sendNonBlocking((const char*)pendingStream.memory + pendingStream.offset, (uint32)(pendingStream.end - (std::size_t)pendingStream.offset));
+                    if (ret == WouldBlock) return true;
+                    if (ret.isError()) return false;
+                    pendingStream.offset += ret.getCount();
+                }
+            }
+#if LinuxHost == 1 && UseTLSServer == 0
+            else if (pendingStream.offset >= 0)
+            {   // Zero copy path
+                Error ret = socket.sendFile(pendingStream.getFileDescriptor(), pendingStream.offset, pendingStream.end - (std::size_t)pendingStream.offset);
+                if (ret == WouldBlock) return true;
+                if (ret.isError()) return false;
             }
+#endif
+            // Done sending the answer
+            parsingStatus = ReqDone;
+            reset();
             return true;
         }
         /** Get the requested, normalized URI, helper function */
         ROString getRequestedPath() const { return reqLine.URI.onlyPath(); }
+        /** Get a parameter captured by the route's pattern, in the pattern's order. For example, "/api/device/:id/sensor/:name" captures
+            the device's identifier and the sensor's name. The capture is a view on the requested path, valid until the answer is sent
+            @return An empty string if there's no such capture */
+        ROString getCapture(const std::size_t index) const { return index < captureCount ? captures[index] : ROString(); }
         /** Check if the client is valid */
         bool isValid() const { return socket.isValid(); }
-        /** Decrease time to live (and close the socket if required)
-            @return true if closed */
-        bool tickTimeToLive() {
-            if (!timeToLive) return false;
-            if (--timeToLive == 0)
-            {
-                reset();
-                return true;
-            }
-            return false;
-        }
         /** Socket was accepted */
-        void accepted() { timeToLive = 255; }
-        /** Socket was remotely closed */
-        void closed() { timeToLive = 0; reset(); }
+        void accepted(const CommonHeaders * headers = nullptr) { keepAlive = true; commonHeaders = headers; }
+        /** Socket was remotely closed (or timed out) */
+        void closed() { keepAlive = false; reset(); }
 
 
     protected:
         /** Reset this client state and buffer. This is called from the server's accept method before actually using the client */
         void reset() {
-            recvBuffer.reset();
+            // Restore the pipelined request, if any (only if the answer was completely sent)
+            if (pipelinedSize && keepAlive && parsingStatus == ReqDone) recvBuffer.restoreTranscient(pipelinedSize, pipelinedVault);
+            else recvBuffer.reset();
+            pipelinedSize = 0;
             reqLine.reset();
             parsingStatus = Invalid;
-            if (!timeToLive) socket.reset();
+            if (!keepAlive) socket.reset();
             answerLength = 0;
             persistVaultSize = 0;
+            captureCount = 0;
+            pendingStream.release();
         }
     };
 
@@ -389,7 +1034,9 @@ namespace Network::Servers::HTTP
 #if MinimizeStackSize == 1
             return ClientAnswer::CommonHeader::sendHeaders(client.socket);
 #else
-            Container::TrackedBuffer buffer { client.recvBuffer.getTail(), client.recvBuffer.freeSize() };
+            // Write the headers directly in the batch's buffer if any, to avoid a copy
+            Container::TrackedBuffer buffer = client.socket.batch ? Container::TrackedBuffer{ client.socket.batch->getTail(), client.socket.batch->freeSize() }
+                                                                  : Container::TrackedBuffer{ client.recvBuffer.getTail(), client.recvBuffer.freeSize() };
             return ClientAnswer::CommonHeader::sendHeaders(client.socket, buffer);
 #endif
         }
@@ -421,6 +1068,70 @@ namespace Network::Servers::HTTP
         CodeAnswer(Code code) : CodeAnswer::ClientAnswer(code) {}
     };
 
+    /** An answer that's entirely known at compile time, like a health check, a robots.txt file, a redirection or a CORS preflight answer.
+        The status line, the headers (given as "Name:value" strings), the Content-Length and the content are serialized at compile time in
+        a single string, so it's sent with a single system call (along with the Connection and common headers, see Client::sendPrebuilt).
+        Usage is like this:
+        @code
+            using Health = StaticAnswer<Code::Ok, "OK", "Content-Type:text/plain", "Cache-Control:no-store">;
+            constexpr Router<Route<Health::answer, MethodsMask{Method::GET, Method::HEAD}, "/health">{}> router;
+            // Or, from any route's callback
+            return client.sendAnswer(Health{});
+        @endcode
+        @param code     The answer's status code
+        @param body     The answer's content
+        @param headers  The answer's headers, like "Content-Type:text/plain", without the line ending */
+    template <Code code, CompileTime::str body, CompileTime::str ... headers>
+    struct StaticAnswer
+    {
+        static constexpr std::size_t length(const char * s) { std::size_t n = 0; while (s[n]) n++; return n; }
+        static constexpr bool isValidHeader(const char * s) { for (; *s; s++) if (*s == '\r' || *s == '\n') return false; return true; }
+        static_assert((isValidHeader(headers.data) && ...), "Headers must not contain a line ending, it's added automatically");
+
+        /** A 204 answer can't have a Content-Length header */
+        static constexpr bool HasLength = code != Code::NoContent;
+        static constexpr std::size_t ContentLength = length(body.data);
+        static constexpr std::size_t StatusLength = sizeof(HTTPAnswer) - 1 + 4 + length(Refl::toString(code)) + 2;
+        static constexpr std::size_t LengthDigits = [] { std::size_t n = 1; for (std::size_t v = ContentLength; v >= 10; v /= 10) n++; return n; }();
+        static constexpr std::size_t HeaderLength = StatusLength + ((length(headers.data) + 2) + ... + 0)
+                                                  + (HasLength ? sizeof("Content-Length:") - 1 + LengthDigits + 2 : 0) + 2;
+
+        /** The serialized answer */
+        struct Serialized
+        {
+            char data[HeaderLength + ContentLength + 1];
+            constexpr Serialized() : data()
+            {
+                std::size_t pos = 0;
+                auto append = [&](const char * s) { while (*s) data[pos++] = *s++; };
+                append(HTTPAnswer);
+                data[pos++] = (char)('0' + (int)code / 100);
+                data[pos++] = (char)('0' + (int)code / 10 % 10);
+                data[pos++] = (char)('0' + (int)code % 10);
+                data[pos++] = ' ';
+                append(Refl::toString(code));
+                append("\r\n");
+                ((append(headers.data), append("\r\n")), ...);
+                if constexpr (HasLength)
+                {
+                    append("Content-Length:");
+                    for (std::size_t v = ContentLength, i = LengthDigits; i; v /= 10) data[pos + --i] = (char)('0' + v % 10);
+                    pos += LengthDigits;
+                    append("\r\n");
+                }
+                append("\r\n");
+                append(body.data);
+            }
+        };
+        static constexpr Serialized serialized{};
+
+        /** Send the answer to the given client */
+        static bool send(Client & client) { return client.sendPrebuilt(serialized.data, StatusLength, HeaderLength, ContentLength, code); }
+
+        /** A route's callback sending this answer */
+        static constexpr auto answer = [](Client & client, const auto &) -> bool { return send(client); };
+    };
+
     /** The get a chunk function that should follow this signature:
         @code
             ROString callback()
@@ -459,7 +1170,12 @@ namespace Network::Servers::HTTP
     };
 
     /** Here we are capturing a lambda function, so we don't know the type and we don't want to perform type erasure for size reasons
-        This structure will use chunked transfer to send pieces of the answer */
+        This structure will use chunked transfer to send pieces of the answer.
+        The pieces are coalesced in the client's receive buffer and sent as a chunk once the chunk size is reached (see ChunkFlushSize),
+        use setChunkSize to change it for this answer, like this:
+        @code
+            return client.sendAnswer(CaptureAnswer{Code::Ok, HeaderSet<Headers::ContentType>{MIMEType::text_plain}, callback}.setChunkSize(1));
+        @endcode */
     template <typename T, typename HS>
     struct CaptureAnswer
     {
@@ -471,9 +1187,12 @@ namespace Network::Servers::HTTP
             headers.setCode(code);
         }
 
+        /** Set the size of the chunks to send, 0 meaning when the client's buffer is full and 1 sending each piece as soon as it's produced */
+        CaptureAnswer & setChunkSize(const std::size_t size) { chunkSize = size; return *this; }
+
         // Proxy the ClientAnswer interface here, using headers' member
         bool sendContent(Client & client, std::size_t & totalSize) {
-            Streams::ChunkedOutput o{client.socket};
+            Streams::BufferedChunkedOutput o{client.socket, client.recvBuffer.getTail(), client.recvBuffer.freeSize(), chunkSize};
             totalSize = 0;
             ROString s = callbackFunc();
             while (s)
@@ -483,8 +1202,7 @@ namespace Network::Servers::HTTP
                 s = callbackFunc();
             }
             // Need to finish sending the flux
-            o.write(nullptr, 0);
-            return true;
+            return o.finish();
         }
         template <Headers h, typename Value>
         void setHeaderIfUnset(Value && v) { headers.template setHeaderIfUnset<h>(std::forward<Value>(v)); }
@@ -500,14 +1218,81 @@ namespace Network::Servers::HTTP
         HS headers;
         /** The lambda function we've captured */
         T callbackFunc;
+        /** The size of the chunks to send */
+        std::size_t chunkSize = ChunkFlushSize;
     };
     /** Add a deducing guide for the lambda function */
     template<typename T, typename V>
     CaptureAnswer(Code, V, T) -> CaptureAnswer<std::decay_t<T>, V>;
 
-    /** A answer solution that's returning the content of the given file */
+    /** The produce callback that should follow this signature:
+        @code
+            std::size_t callback(uint8 * buffer, std::size_t size)
+        @endcode
+
+        Write the next part of the content in the given buffer (up to size bytes) and return the written length.
+        Return 0 to stop being called back */
+    template <typename Func>
+    concept ProduceCallback = requires (Func f, uint8 * buffer, std::size_t size) {
+        // Make sure the signature matches
+        std::size_t {f(buffer, size)};
+    };
+
+    /** Same as CaptureAnswer, but the callback writes the content in place, directly in the client's buffer, instead of returning a string.
+        The written content is framed as a chunk and sent from there, so it's never copied.
+        The callback is given at least half of the client's free buffer space on each call.
+        Usage is like this:
+        @code
+            constexpr auto sensors = [](Client & client, const auto &) {
+                int n = 0;
+                return client.sendAnswer(ProducerAnswer{Code::Ok, HeaderSet<Headers::ContentType>{MIMEType::application_json}, [&](uint8 * buffer, std::size_t size) -> std::size_t {
+                    if (n == sensorCount) return 0;
+                    int l = snprintf((char*)buffer, size, "%s{\"value\":%d}", n ? "," : "", readSensor(n));
+                    n++;
+                    return l;
+                }});
+            };
+        @endcode */
+    template <typename T, typename HS>
+    struct ProducerAnswer : public CaptureAnswer<T, HS>
+    {
+        /** This constructor is used for deduction guide */
+        template <typename V>
+        ProducerAnswer(Code code, V && v, T f) : ProducerAnswer::CaptureAnswer(code, std::forward<V>(v), f) {}
+
+        /** Set the size of the chunks to send, see CaptureAnswer::setChunkSize */
+        ProducerAnswer & setChunkSize(const std::size_t size) { this->chunkSize = size; return *this; }
+
+        bool sendContent(Client & client, std::size_t & totalSize)
+        {
+            Streams::BufferedChunkedOutput o{client.socket, client.recvBuffer.getTail(), client.recvBuffer.freeSize(), this->chunkSize};
+            totalSize = 0;
+            while (true)
+            {
+                if (o.freeSize() < o.getCapacity() / 2 && !o.flush()) return false;
+                std::size_t size = this->callbackFunc(o.getTail(), o.freeSize());
+                if (!size) break;
+                // The callback wrote more than it was allowed to (or its content was truncated)
+                if (size > o.freeSize()) return false;
+                if (!o.commit(size)) return false;
+                totalSize += size;
+            }
+            // Need to finish sending the flux
+            return o.finish();
+        }
+    };
+    /** Add a deducing guide for the lambda function */
+    template<typename T, typename V>
+    ProducerAnswer(Code, V, T) -> ProducerAnswer<std::decay_t<T>, V>;
+
+    /** A answer solution that's returning the content of the given file.
+        If built with the request's headers, the Range header is honored: the requested range is sent with a 206 Partial Content status,
+        or a multipart/byteranges content for multiple ranges, or a 416 status if no range can be satisfied.
+        The file's validators (ETag and Last-Modified) are sent too in that case, and with MaxSupport, the conditional headers (If-None-Match,
+        If-Modified-Since and If-Range) are evaluated before the file is opened: if the client's copy is still valid, a 304 answer is sent
+        without any content */
     template <typename InputStream, Headers ... answerHeaders>
-    struct FileAnswer : public ClientAnswer<FileAnswer<InputStream, answerHeaders...>, Headers::ContentType, answerHeaders...>
+    struct FileAnswer : public ClientAnswer<FileAnswer<InputStream, answerHeaders...>, Headers::ContentType, Headers::AcceptRanges, Headers::ContentRange, answerHeaders...>
     {
         InputStream & getInputStream(Socket &) { return stream; }
 
@@ -532,9 +1317,302 @@ namespace Network::Servers::HTTP
                 this->template setHeader<Headers::ContentType>(getMIMEFromExtension(path.fromLast(".")));
             } else this->template setHeader<Headers::ContentType>(MIMEType::Invalid);
         }
+
+        /** Build a file answer for the given path, honoring the client's conditional and Range headers, if any
+            @param headers  The request's headers, they must contain the Range header or the conditional headers
+            @param method   The request's method, If-Modified-Since is only evaluated for GET and HEAD */
+        template <typename H> requires (HasHeader<H, Headers::Range> || ConditionalHeaders<H>)
+        FileAnswer(const char * path, const H & headers, const Method method = Method::GET) : FileAnswer(ConditionalPath(path, headers, method), headers) {}
+
+        /** The requested ranges, if any */
+        const ByteRanges * getRanges() const { return requested ? &ranges : nullptr; }
+        bool sendHeaders(Client & client)
+        {
+            static constexpr const char Multipart[] = "Content-Type:multipart/byteranges; boundary=";
+            if (!FileAnswer::ClientAnswer::sendHeaders(client) || !validators.send(client.socket)) return false;
+            if (!requested || ranges.count < 2) return true;
+            client.socket.send(Multipart, sizeof(Multipart) - 1);
+            client.socket.send(ByteRanges::Boundary, sizeof(ByteRanges::Boundary) - 1);
+            return !client.socket.send(EOM, 2).isError();
+        }
+
         InputStream stream;
+
+    private:
+        ByteRanges  ranges;
+        Validators  validators;
+        bool        requested = false;
+        char        contentRange[sizeof("bytes 18446744073709551615-18446744073709551615/18446744073709551615")];
+
+        /** The path to a file and its validators, checked against the request's conditional headers */
+        struct ConditionalPath
+        {
+            const char * path;
+            Validators validators;
+            bool notModified;
+
+            template <typename H>
+            ConditionalPath(const char * path, const H & headers, const Method method) : path(path), validators(path), notModified(validators.isNotModified(headers, method)) {}
+            // Don't open the file if the client's copy is still valid
+            const char * getPath() const { return notModified ? "" : path; }
+        };
+
+        template <typename H>
+        FileAnswer(const ConditionalPath & conditional, const H & headers) : FileAnswer(conditional.getPath())
+        {
+            validators = conditional.validators;
+            if (conditional.notModified)
+            {
+                this->setCode(Code::NotModified);
+                return;
+            }
+            if (!stream.hasContent()) return;
+            this->template setHeader<Headers::AcceptRanges>(ROString("bytes"));
+            if constexpr (HasHeader<H, Headers::Range>)
+            {
+                const ROString & range = headers.template getHeader<Headers::Range>().parsed.value;
+                if (!range || !validators.isRangeValid(headers) || !ranges.parse(range, stream.getSize())) return;
+
+                requested = true;
+                if (ranges.count == 1) this->template setHeader<Headers::ContentRange>(ROString(contentRange, (int)ranges.formatContentRange(contentRange, 0)));
+                else if (!ranges.count)
+                {
+                    this->setCode(Code::RequestRange);
+                    this->template setHeader<Headers::ContentRange>(ROString(contentRange, (int)ranges.formatContentRange(contentRange, 0)));
+                    return;
+                }
+                else
+                {   // The content type is the one of the parts, the answer's one is sent with the boundary
+                    ranges.type = Refl::toString(getMIMEFromExtension(ROString(conditional.path).fromLast(".")));
+                    this->template setHeader<Headers::ContentType>(MIMEType::Invalid);
+                }
+                this->setCode(Code::PartialContent);
+            }
+        }
+    };
+
+    /** Get the quality the client gives to the given encoding in its Accept-Encoding header, in thousandths (0 meaning it's refused).
+        The identity encoding is accepted unless it's explicitly refused, but with the lowest quality if it isn't listed */
+    template <typename H>
+    static uint16 getEncodingQuality(const H & headers, const Encoding encoding)
+    {
+        uint16 any = encoding == Encoding::identity ? 1 : 0;
+        if constexpr (HasHeader<H, Headers::AcceptEncoding>)
+        {
+            const auto & accept = headers.template getHeader<Headers::AcceptEncoding>().parsed;
+            for (uint8 i = 0; i < accept.count; i++)
+            {
+                if (accept.value[i].value == encoding) return accept.value[i].quality;
+                if (accept.value[i].value == Encoding::all) any = accept.value[i].quality;
+            }
+        }
+        return any;
+    }
+
+    /** Select the encoding to use for an answer, honoring the client's preferences (q-values) from its Accept-Encoding header.
+        The encodings are tried from the most to the least preferred by the client, until one is available. An encoding that's as preferred as
+        the identity encoding is used since it saves bandwidth, and so is the first of the given encodings for the same quality.
+        @param encodings    The encodings that can be used, in the server's preference order
+        @param isAvailable  A callback with a bool (Encoding) signature, returning true if the content is available with the given encoding
+        @return the selected encoding or Encoding::identity if none is acceptable and available, or Encoding::Invalid if the identity encoding
+                is refused too (with "identity;q=0" or "*;q=0"), so no variant is acceptable and a 406 Not Acceptable answer should be sent */
+    template <typename H, typename Func>
+    static Encoding selectEncoding(const H & headers, std::initializer_list<Encoding> encodings, Func && isAvailable)
+    {
+        const uint16 identity = getEncodingQuality(headers, Encoding::identity);
+        uint32 tried = 0;
+        while (true)
+        {
+            Encoding best = Encoding::identity;
+            uint16 bestQuality = 0, i = 0, bestIndex = 0;
+            for (Encoding e : encodings)
+            {
+                uint16 q = getEncodingQuality(headers, e);
+                if (e != Encoding::identity && !(tried & (1U << i)) && q && q >= identity && q > bestQuality) { best = e; bestQuality = q; bestIndex = i; }
+                i++;
+            }
+            if (best == Encoding::identity) return identity ? best : Encoding::Invalid;
+            if (isAvailable(best)) return best;
+            tried |= 1U << bestIndex;
+        }
+    }
+    /** Select the encoding to use for an answer among the given ones, honoring the client's preferences */
+    template <typename H>
+    static Encoding selectEncoding(const H & headers, std::initializer_list<Encoding> encodings) { return selectEncoding(headers, encodings, [](Encoding) { return true; }); }
+
+    /** A file answer that's sending a compressed variant of the file if the client accepts it (see selectEncoding).
+        For a file at "path", the variants are the "path.br" and "path.gz" files, if they exist. For an in-memory content, the compressed variants
+        are given to the constructor.
+        The Vary header is always sent since the answer depends on the client's Accept-Encoding header. If the client refuses the identity
+        encoding and no compressed variant is acceptable, a 406 Not Acceptable answer is sent */
+    template <typename InputStream, Headers ... answerHeaders>
+    struct EncodedFileAnswer : public ClientAnswer<EncodedFileAnswer<InputStream, answerHeaders...>, Headers::ContentType, Headers::ContentEncoding, Headers::Vary, answerHeaders...>
+    {
+        InputStream & getInputStream(Socket &) { return stream; }
+
+        /** A compressed variant of an in-memory content */
+        struct Variant
+        {
+            Encoding encoding;
+            ROString content;
+        };
+        /** The maximum path length for a file with compressed variants (longer paths are sent uncompressed) */
+        static constexpr std::size_t MaxPathLength = 256;
+
+        /** Build a file answer for the given path, sending its compressed variant if any is accepted
+            @param headers  The request's headers, they must contain the Accept-Encoding header */
+        template <typename H>
+        EncodedFileAnswer(const char * path, const H & headers) : EncodedFileAnswer(VariantPath(path, headers)) {}
+
+        /** Build an answer for the given in-memory content, sending one of its compressed variants if it's accepted
+            @param path     The content's path, used to deduce its MIME type
+            @param variants The compressed variants of the content, in the server's preference order
+            @param headers  The request's headers, they must contain the Accept-Encoding header */
+        template <typename H>
+        EncodedFileAnswer(const ROString & path, const ROString & content, std::initializer_list<Variant> variants, const H & headers)
+            : EncodedFileAnswer::ClientAnswer(Code::NotFound), stream(content)
+        {
+            if (!stream.hasContent()) { this->template setHeader<Headers::ContentType>(MIMEType::Invalid); return; }
+            Encoding encodings[4] = { Encoding::identity, Encoding::identity, Encoding::identity, Encoding::identity };
+            std::size_t count = 0;
+            for (const Variant & v : variants) if (count < 4) encodings[count++] = v.encoding;
+
+            const Variant * selected = nullptr;
+            const Encoding encoding = selectEncoding(headers, { encodings[0], encodings[1], encodings[2], encodings[3] }, [&](Encoding e) {
+                for (const Variant & v : variants) if (v.encoding == e) { selected = &v; return true; }
+                return false;
+            });
+            if (encoding == Encoding::Invalid)
+            {
+                stream = InputStream(ROString());
+                notAcceptable();
+                return;
+            }
+            if (selected)
+            {
+                stream = InputStream(selected->content);
+                this->template setHeader<Headers::ContentEncoding>(selected->encoding);
+            }
+            this->setCode(Code::Ok);
+            this->template setHeader<Headers::ContentType>(getMIMEFromExtension(path.fromLast(".")));
+            this->template setHeader<Headers::Vary>(ROString("Accept-Encoding"));
+        }
+        InputStream stream;
+
+    private:
+        /** The path to the selected variant of a file */
+        struct VariantPath
+        {
+            const char * original;
+            char path[MaxPathLength];
+            Encoding encoding;
+
+            template <typename H>
+            VariantPath(const char * original, const H & headers) : original(original), encoding(Encoding::identity)
+            {
+                std::size_t length = strlen(original);
+                if (length + sizeof(".gz") > sizeof(path)) return;
+                memcpy(path, original, length);
+                encoding = selectEncoding(headers, { Encoding::br, Encoding::gzip }, [&](Encoding e) {
+                    memcpy(&path[length], e == Encoding::br ? ".br" : ".gz", sizeof(".gz"));
+                    struct stat st;
+                    return ::stat(path, &st) == 0 && S_ISREG(st.st_mode);
+                });
+            }
+            // Don't open any file if no variant is acceptable
+            const char * getPath() const { return encoding == Encoding::identity ? original : encoding == Encoding::Invalid ? "" : path; }
+        };
+
+        /** Answer 406 Not Acceptable, with the Vary header since this depends on the client's Accept-Encoding header */
+        void notAcceptable()
+        {
+            this->setCode(Code::NotAcceptable);
+            this->template setHeader<Headers::ContentType>(MIMEType::Invalid);
+            this->template setHeader<Headers::Vary>(ROString("Accept-Encoding"));
+        }
+
+        EncodedFileAnswer(const VariantPath & variant) : EncodedFileAnswer::ClientAnswer(Code::NotFound), stream(variant.getPath())
+        {
+            // Check if the file is found
+            if (variant.encoding == Encoding::Invalid) notAcceptable();
+            else if (stream.hasContent())
+            {
+                this->setCode(Code::Ok);
+                if (variant.encoding != Encoding::identity) this->template setHeader<Headers::ContentEncoding>(variant.encoding);
+                // The MIME type is the one of the original file
+                this->template setHeader<Headers::ContentType>(getMIMEFromExtension(ROString(variant.original).fromLast(".")));
+                this->template setHeader<Headers::Vary>(ROString("Accept-Encoding"));
+            } else this->template setHeader<Headers::ContentType>(MIMEType::Invalid);
+        }
     };
 
+    /** Same as CaptureAnswer, but the content is compressed on the fly if the client accepts it (gzip is preferred over deflate).
+        The route must list the Accept-Encoding header in its headers, else the content is sent uncompressed.
+        Usage is like this:
+        @code
+            static Streams::DeflateState<> deflateState; // Large object, don't put it on the stack
+            constexpr auto telemetry = [](Client & client, const auto & headers) {
+                return client.sendAnswer(CompressedCaptureAnswer{headers, deflateState, Code::Ok, HeaderSet<Headers::ContentType>{MIMEType::application_json}, [&]() -> ROString { ... }});
+            };
+        @endcode
+        @param State    The compressor's state, see Streams::DeflateState */
+    template <typename T, typename HS, typename State>
+    struct CompressedCaptureAnswer : public CaptureAnswer<T, HS>
+    {
+        /** This constructor is used for deduction guide
+            @param reqHeaders   The request's headers, used to select the encoding
+            @param state        The compressor's state, it's only used while sending this answer */
+        template <typename H, typename V>
+        CompressedCaptureAnswer(const H & reqHeaders, State & state, Code code, V && v, T f)
+            : CompressedCaptureAnswer::CaptureAnswer(code, std::forward<V>(v), f), state(state), encoding(selectEncoding(reqHeaders, { Encoding::gzip, Encoding::deflate }))
+        {   // The content's status is already decided by the caller, so it's sent uncompressed even if the client refuses it
+            if (encoding == Encoding::Invalid) encoding = Encoding::identity;
+        }
+
+        bool sendHeaders(Client & client)
+        {
+            static constexpr const char Gzip[] = "Content-Encoding:gzip\r\nVary:Accept-Encoding\r\n";
+            static constexpr const char Deflate[] = "Content-Encoding:deflate\r\nVary:Accept-Encoding\r\n";
+            static constexpr const char Identity[] = "Vary:Accept-Encoding\r\n";
+            if (!this->headers.sendHeaders(client)) return false;
+            // The answer depends on the Accept-Encoding header, so the caches must know about it
+            if (encoding == Encoding::gzip) return !client.socket.send(Gzip, sizeof(Gzip) - 1).isError();
+            if (encoding == Encoding::deflate) return !client.socket.send(Deflate, sizeof(Deflate) - 1).isError();
+            return !client.socket.send(Identity, sizeof(Identity) - 1).isError();
+        }
+
+        /** Set the size of the (compressed) chunks to send, see CaptureAnswer::setChunkSize */
+        CompressedCaptureAnswer & setChunkSize(const std::size_t size) { this->chunkSize = size; return *this; }
+
+        bool sendContent(Client & client, std::size_t & totalSize)
+        {
+            if (encoding == Encoding::identity) return CompressedCaptureAnswer::CaptureAnswer::sendContent(client, totalSize);
+
+            typedef Streams::DeflateOutput<Streams::BufferedChunkedOutput, State> Compressor;
+            Streams::BufferedChunkedOutput o{client.socket, client.recvBuffer.getTail(), client.recvBuffer.freeSize(), this->chunkSize};
+            // The deflate content encoding is the zlib format, not a raw deflate stream (RFC9110 8.4.1.2)
+            Compressor c{o, state, encoding == Encoding::gzip ? Compressor::Gzip : Compressor::Zlib};
+            totalSize = 0;
+            ROString s = this->callbackFunc();
+            while (s)
+            {
+                if (c.write(s.getData(), s.getLength()) != s.getLength()) return false;
+                totalSize += (std::size_t)s.getLength();
+                s = this->callbackFunc();
+            }
+            // Need to finish sending the flux
+            return c.finish() && o.finish();
+        }
+
+        /** The compressor's state */
+        State & state;
+        /** The selected encoding */
+        Encoding encoding;
+    };
+    /** Add a deducing guide for the lambda function */
+    template<typename H, typename State, typename T, typename V>
+    CompressedCaptureAnswer(const H &, State &, Code, V, T) -> CompressedCaptureAnswer<std::decay_t<T>, V, State>;
+
     bool Client::reply(Code statusCode, const ROString & msg, bool close)
     {
         // Check if the msg is in the recv buffer (can happen with request with content), and in that case, it need to be persisted in the vault
@@ -543,7 +1621,7 @@ namespace Network::Servers::HTTP
         {   // Persist it
             if (!Container::persistString(const_cast<ROString&>(msg), recvBuffer, recvBuffer.getSize())) return false;
         }
-        if (close) timeToLive = 0;
+        if (close) keepAlive = false;
         return sendAnswer(SimpleAnswer<MIMEType::text_plain>{statusCode, msg });
     }
     bool Client::reply(Code statusCode) { return sendAnswer(CodeAnswer{statusCode}); }
@@ -0,0 +1,111 @@
+#ifndef hpp_ROMAssets_hpp
+#define hpp_ROMAssets_hpp
+
+// We need the routes declaration
+#include "Route.hpp"
+
+#include <iterator>
+
+namespace Network::Servers::HTTP
+{
+    /** The hash function used for the embedded assets' perfect hash. This must match the one in tools/ROMAssets.py */
+    constexpr uint32 assetHash(const char * path, const std::size_t length, const uint32 seed)
+    {
+        uint32 h = 2166136261U ^ seed;
+        for (std::size_t i = 0; i < length; i++) { h ^= (uint8)path[i]; h *= 16777619U; }
+        // FNV's low bits are weak, so mix them before they are used as an index
+        h ^= h >> 16; h *= 0x85EBCA6BU;
+        h ^= h >> 13; h *= 0xC2B2AE35U;
+        return h ^ (h >> 16);
+    }
+
+    /** The length of the assets' prebuilt status line: "HTTP/1.1 200 Ok\r\n" */
+    static constexpr std::size_t ROMStatusLength = sizeof("HTTP/1.1 200 Ok\r\n") - 1;
+
+    /** An asset embedded in the binary.
+        The answers are stored with their status line and headers already serialized, followed by the content, so they are sent as is */
+    struct ROMAsset
+    {
+        const char *    path;
+        uint16          pathLength;
+        /** The identity answer */
+        const uint8 *   answer;
+        uint16          headerLength;
+        uint32          contentLength;
+        /** The gzip encoded answer, if any */
+        const uint8 *   gzipAnswer;
+        uint16          gzipHeaderLength;
+        uint32          gzipContentLength;
+    };
+
+    /** A bundle of assets embedded in the binary, as generated by tools/ROMAssets.py.
+        Assets are found with a minimal perfect hash (hash and displace): the path is hashed a first time to find its bucket, then a second
+        time with the bucket's seed to find the asset's index. A lookup costs 2 hashes and a single string comparison, whatever the asset count.
+        @param assets   The assets array, sorted by their perfect hash index
+        @param seeds    The seed for each bucket */
+    template <const auto & assets, const auto & seeds>
+    struct ROMBundle
+    {
+        static constexpr std::size_t AssetCount = std::size(assets);
+        static constexpr std::size_t BucketCount = std::size(seeds);
+        static_assert(AssetCount > 0 && BucketCount > 0, "Empty asset bundle");
+
+        /** Find the asset for the given path
+            @return A pointer to the asset or nullptr if not found */
+        static const ROMAsset * find(const ROString & path)
+        {
+            const std::size_t length = (std::size_t)path.getLength();
+            const uint32 seed = seeds[assetHash(path.getData(), length, 0) % BucketCount];
+            const ROMAsset & asset = assets[assetHash(path.getData(), length, seed) % AssetCount];
+            return asset.pathLength == length && !memcmp(asset.path, path.getData(), length) ? &asset : nullptr;
+        }
+
+        /** Find the entity tag in an asset's serialized headers */
+        static ROString findETag(const uint8 * answer, const std::size_t headerLength)
+        {
+            static constexpr const char Name[] = "\r\nETag:";
+            const char * p = (const char*)answer, * e = p + headerLength;
+            for (; p + sizeof(Name) - 1 < e; p++)
+            {
+                if (memcmp(p, Name, sizeof(Name) - 1)) continue;
+                const char * v = p + sizeof(Name) - 1, * end = v;
+                while (end < e && *end != '\r') end++;
+                return ROString(v, (int)(end - v));
+            }
+            return ROString();
+        }
+
+        /** The route's callback, serving the bundle's assets.
+            The client's copy is revalidated with its entity tag (the content's hash) if the route has the If-None-Match header */
+        static constexpr auto answer = [](Client & client, const auto & headers) -> bool
+        {
+            const ROMAsset * asset = find(client.getRequestedPath());
+            if (!asset) return client.reply(Code::NotFound);
+            const Encoding encoding = selectEncoding(headers, { Encoding::gzip }, [&](Encoding) { return asset->gzipAnswer != nullptr; });
+            if (encoding == Encoding::Invalid) return client.reply(Code::NotAcceptable);
+            const bool gzip = encoding == Encoding::gzip;
+            const uint8 * answer = gzip ? asset->gzipAnswer : asset->answer;
+            const std::size_t headerLength = gzip ? asset->gzipHeaderLength : asset->headerLength;
+            Code code = Code::Ok;
+            if constexpr (ConditionalHeaders<std::decay_t<decltype(headers)>>)
+                if (Validators(findETag(answer, headerLength)).isNotModified(headers, client.reqLine.method)) code = Code::NotModified;
+            return client.sendPrebuilt((const char*)answer, ROMStatusLength, headerLength, gzip ? asset->gzipContentLength : asset->contentLength, code);
+        };
+    };
+
+    /** A catch all route serving the given bundle's assets (and 404 for any other path), so it must be the last route of the router.
+        Usage is like this:
+        @code
+            // Generated with: python3 tools/ROMAssets.py www WebUI.hpp WebUI
+            #include "WebUI.hpp"
+            constexpr Router<Route<api, MethodsMask{Method::GET}, "/api">{}, ROMAssetsRoute<WebUI::Bundle>{}> router;
+        @endcode */
+    template <typename Bundle>
+#if MaxSupport == 1
+    using ROMAssetsRoute = DefaultRoute<Bundle::answer, MethodsMask{Method::GET, Method::HEAD}, Headers::AcceptEncoding, Headers::IfNoneMatch>;
+#else
+    using ROMAssetsRoute = DefaultRoute<Bundle::answer, MethodsMask{Method::GET, Method::HEAD}, Headers::AcceptEncoding>;
+#endif
+}
+
+#endif
@@ -4,6 +4,8 @@
 // We need Client declaration
 #include "HTTP.hpp"
 #include "Tools/FuncRef.hpp"
+// We need timer wheel for the clients' timeouts
+#include "Container/TimerWheel.hpp"
 
 // We need offsetof for making the container_of macro
 #include <cstddef>
@@ -31,15 +33,15 @@ namespace Network::Servers::HTTP
         // Make sure the signature matches (try with the largest possible header array here)
         f(c, HeadersArray<std::array{
 #ifdef MaxSupport
-                Headers::Accept, Headers::AcceptCharset, Headers::AcceptDatetime, Headers::AcceptEncoding, Headers::AcceptLanguage, Headers::AcceptPatch, Headers::AcceptRanges, Headers::AccessControlAllowCredentials, Headers::AccessControlAllowHeaders, Headers::AccessControlAllowMethods, Headers::AccessControlAllowOrigin, Headers::AccessControlExposeHeaders, Headers::AccessControlMaxAge, Headers::AccessControlRequestMethod, Headers::Allow, Headers::Authorization, Headers::CacheControl, Headers::Connection, Headers::ContentDisposition, Headers::ContentEncoding, Headers::ContentLanguage, Headers::ContentLength, Headers::ContentLocation, Headers::ContentRange, Headers::ContentType, Headers::Cookie, Headers::Date, Headers::ETag, Headers::Expect, Headers::Expires, Headers::Forwarded, Headers::From, Headers::Host, Headers::IfMatch, Headers::IfModifiedSince, Headers::IfNoneMatch, Headers::IfRange, Headers::IfUnmodifiedSince, Headers::LastModified, Headers::Link, Headers::Location, Headers::MaxForwards, Headers::Origin, Headers::Pragma, Headers::Prefer, Headers::ProxyAuthorization, Headers::Range, Headers::Referer, Headers::Server, Headers::SetCookie, Headers::StrictTransportSecurity, Headers::TE, Headers::Trailer, Headers::TransferEncoding, Headers::Upgrade, Headers::UserAgent, Headers::Via, Headers::WWWAuthenticate, Headers::XClientDate, Headers::XForwardedFor
+                Headers::Accept, Headers::AcceptCharset, Headers::AcceptDatetime, Headers::AcceptEncoding, Headers::AcceptLanguage, Headers::AcceptPatch, Headers::AcceptRanges, Headers::AccessControlAllowCredentials, Headers::AccessControlAllowHeaders, Headers::AccessControlAllowMethods, Headers::AccessControlAllowOrigin, Headers::AccessControlExposeHeaders, Headers::AccessControlMaxAge, Headers::AccessControlRequestMethod, Headers::Allow, Headers::Authorization, Headers::CacheControl, Headers::Connection, Headers::ContentDisposition, Headers::ContentEncoding, Headers::ContentLanguage, Headers::ContentLength, Headers::ContentLocation, Headers::ContentRange, Headers::ContentType, Headers::Cookie, Headers::Date, Headers::ETag, Headers::Expect, Headers::Expires, Headers::Forwarded, Headers::From, Headers::Host, Headers::IfMatch, Headers::IfModifiedSince, Headers::IfNoneMatch, Headers::IfRange, Headers::IfUnmodifiedSince, Headers::LastModified, Headers::Link, Headers::Location, Headers::MaxForwards, Headers::Origin, Headers::Pragma, Headers::Prefer, Headers::ProxyAuthorization, Headers::Range, Headers::Referer, Headers::Server, Headers::SetCookie, Headers::StrictTransportSecurity, Headers::TE, Headers::Trailer, Headers::TransferEncoding, Headers::Upgrade, Headers::UserAgent, Headers::Vary, Headers::Via, Headers::WWWAuthenticate, Headers::XClientDate, Headers::XForwardedFor
 #else
-                Headers::Accept, Headers::AcceptEncoding, Headers::AcceptLanguage, Headers::AcceptRanges, Headers::AccessControlAllowOrigin, Headers::Authorization, Headers::CacheControl, Headers::Connection, Headers::ContentDisposition, Headers::ContentEncoding, Headers::ContentLanguage, Headers::ContentLength, Headers::ContentRange, Headers::ContentType, Headers::Cookie, Headers::Date, Headers::Expires, Headers::Host, Headers::LastModified, Headers::Location, Headers::Origin, Headers::Pragma, Headers::Range, Headers::Referer, Headers::Server, Headers::SetCookie, Headers::TE, Headers::TransferEncoding, Headers::Upgrade, Headers::UserAgent, Headers::WWWAuthenticate
+                Headers::Accept, Headers::AcceptEncoding, Headers::AcceptLanguage, Headers::AcceptRanges, Headers::AccessControlAllowOrigin, Headers::Authorization, Headers::CacheControl, Headers::Connection, Headers::ContentDisposition, Headers::ContentEncoding, Headers::ContentLanguage, Headers::ContentLength, Headers::ContentRange, Headers::ContentType, Headers::Cookie, Headers::Date, Headers::Expires, Headers::Host, Headers::LastModified, Headers::Location, Headers::Origin, Headers::Pragma, Headers::Range, Headers::Referer, Headers::Server, Headers::SetCookie, Headers::TE, Headers::TransferEncoding, Headers::Upgrade, Headers::UserAgent, Headers::Vary, Headers::WWWAuthenticate
 #endif
             }, Container::TypeList<
 #ifdef MaxSupport
-                RequestHeader<Headers::Accept>, RequestHeader<Headers::AcceptCharset>, RequestHeader<Headers::AcceptDatetime>, RequestHeader<Headers::AcceptEncoding>, RequestHeader<Headers::AcceptLanguage>, RequestHeader<Headers::AcceptPatch>, RequestHeader<Headers::AcceptRanges>, RequestHeader<Headers::AccessControlAllowCredentials>, RequestHeader<Headers::AccessControlAllowHeaders>, RequestHeader<Headers::AccessControlAllowMethods>, RequestHeader<Headers::AccessControlAllowOrigin>, RequestHeader<Headers::AccessControlExposeHeaders>, RequestHeader<Headers::AccessControlMaxAge>, RequestHeader<Headers::AccessControlRequestMethod>, RequestHeader<Headers::Allow>, RequestHeader<Headers::Authorization>, RequestHeader<Headers::CacheControl>, RequestHeader<Headers::Connection>, RequestHeader<Headers::ContentDisposition>, RequestHeader<Headers::ContentEncoding>, RequestHeader<Headers::ContentLanguage>, RequestHeader<Headers::ContentLength>, RequestHeader<Headers::ContentLocation>, RequestHeader<Headers::ContentRange>, RequestHeader<Headers::ContentType>, RequestHeader<Headers::Cookie>, RequestHeader<Headers::Date>, RequestHeader<Headers::ETag>, RequestHeader<Headers::Expect>, RequestHeader<Headers::Expires>, RequestHeader<Headers::Forwarded>, RequestHeader<Headers::From>, RequestHeader<Headers::Host>, RequestHeader<Headers::IfMatch>, RequestHeader<Headers::IfModifiedSince>, RequestHeader<Headers::IfNoneMatch>, RequestHeader<Headers::IfRange>, RequestHeader<Headers::IfUnmodifiedSince>, RequestHeader<Headers::LastModified>, RequestHeader<Headers::Link>, RequestHeader<Headers::Location>, RequestHeader<Headers::MaxForwards>, RequestHeader<Headers::Origin>, RequestHeader<Headers::Pragma>, RequestHeader<Headers::Prefer>, RequestHeader<Headers::ProxyAuthorization>, RequestHeader<Headers::Range>, RequestHeader<Headers::Referer>, RequestHeader<Headers::Server>, RequestHeader<Headers::SetCookie>, RequestHeader<Headers::StrictTransportSecurity>, RequestHeader<Headers::TE>, RequestHeader<Headers::Trailer>, RequestHeader<Headers::TransferEncoding>, RequestHeader<Headers::Upgrade>, RequestHeader<Headers::UserAgent>, RequestHeader<Headers::Via>, RequestHeader<Headers::WWWAuthenticate>, RequestHeader<Headers::XClientDate>, RequestHeader<Headers::XForwardedFor>
+                RequestHeader<Headers::Accept>, RequestHeader<Headers::AcceptCharset>, RequestHeader<Headers::AcceptDatetime>, RequestHeader<Headers::AcceptEncoding>, RequestHeader<Headers::AcceptLanguage>, RequestHeader<Headers::AcceptPatch>, RequestHeader<Headers::AcceptRanges>, RequestHeader<Headers::AccessControlAllowCredentials>, RequestHeader<Headers::AccessControlAllowHeaders>, RequestHeader<Headers::AccessControlAllowMethods>, RequestHeader<Headers::AccessControlAllowOrigin>, RequestHeader<Headers::AccessControlExposeHeaders>, RequestHeader<Headers::AccessControlMaxAge>, RequestHeader<Headers::AccessControlRequestMethod>, RequestHeader<Headers::Allow>, RequestHeader<Headers::Authorization>, RequestHeader<Headers::CacheControl>, RequestHeader<Headers::Connection>, RequestHeader<Headers::ContentDisposition>, RequestHeader<Headers::ContentEncoding>, RequestHeader<Headers::ContentLanguage>, RequestHeader<Headers::ContentLength>, RequestHeader<Headers::ContentLocation>, RequestHeader<Headers::ContentRange>, RequestHeader<Headers::ContentType>, RequestHeader<Headers::Cookie>, RequestHeader<Headers::Date>, RequestHeader<Headers::ETag>, RequestHeader<Headers::Expect>, RequestHeader<Headers::Expires>, RequestHeader<Headers::Forwarded>, RequestHeader<Headers::From>, RequestHeader<Headers::Host>, RequestHeader<Headers::IfMatch>, RequestHeader<Headers::IfModifiedSince>, RequestHeader<Headers::IfNoneMatch>, RequestHeader<Headers::IfRange>, RequestHeader<Headers::IfUnmodifiedSince>, RequestHeader<Headers::LastModified>, RequestHeader<Headers::Link>, RequestHeader<Headers::Location>, RequestHeader<Headers::MaxForwards>, RequestHeader<Headers::Origin>, RequestHeader<Headers::Pragma>, RequestHeader<Headers::Prefer>, RequestHeader<Headers::ProxyAuthorization>, RequestHeader<Headers::Range>, RequestHeader<Headers::Referer>, RequestHeader<Headers::Server>, RequestHeader<Headers::SetCookie>, RequestHeader<Headers::StrictTransportSecurity>, RequestHeader<Headers::TE>, RequestHeader<Headers::Trailer>, RequestHeader<Headers::TransferEncoding>, RequestHeader<Headers::Upgrade>, RequestHeader<Headers::UserAgent>, RequestHeader<Headers::Vary>, RequestHeader<Headers::Via>, RequestHeader<Headers::WWWAuthenticate>, RequestHeader<Headers::XClientDate>, RequestHeader<Headers::XForwardedFor>
 #else
-                RequestHeader<Headers::Accept>, RequestHeader<Headers::AcceptEncoding>, RequestHeader<Headers::AcceptLanguage>, RequestHeader<Headers::AcceptRanges>, RequestHeader<Headers::AccessControlAllowOrigin>, RequestHeader<Headers::Authorization>, RequestHeader<Headers::CacheControl>, RequestHeader<Headers::Connection>, RequestHeader<Headers::ContentDisposition>, RequestHeader<Headers::ContentEncoding>, RequestHeader<Headers::ContentLanguage>, RequestHeader<Headers::ContentLength>, RequestHeader<Headers::ContentRange>, RequestHeader<Headers::ContentType>, RequestHeader<Headers::Cookie>, RequestHeader<Headers::Date>, RequestHeader<Headers::Expires>, RequestHeader<Headers::Host>, RequestHeader<Headers::LastModified>, RequestHeader<Headers::Location>, RequestHeader<Headers::Origin>, RequestHeader<Headers::Pragma>, RequestHeader<Headers::Range>, RequestHeader<Headers::Referer>, RequestHeader<Headers::Server>, RequestHeader<Headers::SetCookie>, RequestHeader<Headers::TE>, RequestHeader<Headers::TransferEncoding>, RequestHeader<Headers::Upgrade>, RequestHeader<Headers::UserAgent>, RequestHeader<Headers::WWWAuthenticate>
+                RequestHeader<Headers::Accept>, RequestHeader<Headers::AcceptEncoding>, RequestHeader<Headers::AcceptLanguage>, RequestHeader<Headers::AcceptRanges>, RequestHeader<Headers::AccessControlAllowOrigin>, RequestHeader<Headers::Authorization>, RequestHeader<Headers::CacheControl>, RequestHeader<Headers::Connection>, RequestHeader<Headers::ContentDisposition>, RequestHeader<Headers::ContentEncoding>, RequestHeader<Headers::ContentLanguage>, RequestHeader<Headers::ContentLength>, RequestHeader<Headers::ContentRange>, RequestHeader<Headers::ContentType>, RequestHeader<Headers::Cookie>, RequestHeader<Headers::Date>, RequestHeader<Headers::Expires>, RequestHeader<Headers::Host>, RequestHeader<Headers::LastModified>, RequestHeader<Headers::Location>, RequestHeader<Headers::Origin>, RequestHeader<Headers::Pragma>, RequestHeader<Headers::Range>, RequestHeader<Headers::Referer>, RequestHeader<Headers::Server>, RequestHeader<Headers::SetCookie>, RequestHeader<Headers::TE>, RequestHeader<Headers::TransferEncoding>, RequestHeader<Headers::Upgrade>, RequestHeader<Headers::UserAgent>, RequestHeader<Headers::Vary>, RequestHeader<Headers::WWWAuthenticate>
 #endif
         >>{}); // Who said we can't feed brainfuck to C++ compiler?
     };
@@ -58,10 +60,61 @@ namespace Network::Servers::HTTP
         static bool accept(Client & client, uint32 methodsMask, const char * route, const std::size_t routeLength)
         {
             if (((1<<(uint32)client.reqLine.method) & methodsMask)
-                && client.reqLine.URI.absolutePath.midString(0, routeLength) == route) // TODO: Use match here instead of plain old string comparison to allow wildcards
+                && client.reqLine.URI.absolutePath.midString(0, routeLength) == ROString(route, (int)routeLength))
                 return true;
             return false;
         }
+
+        /** The length of a route's static part, before its first parameter (':' or '*') */
+        static constexpr std::size_t staticLength(const char * route)
+        {
+            std::size_t n = 0;
+            while (route && route[n] && route[n] != ':' && route[n] != '*') n++;
+            return n;
+        }
+        /** Count the parameters of a route's pattern, or return -1 if the pattern is invalid (the '*' parameter must be the last) */
+        static constexpr int countParameters(const char * route)
+        {
+            int n = 0;
+            for (std::size_t i = 0; route[i]; i++)
+            {
+                if (route[i] == ':') n++;
+                else if (route[i] == '*') { if (route[i + 1]) return -1; n++; }
+            }
+            return n;
+        }
+        /** Match the requested path, after the route's static part, with the rest of the route's pattern and capture its parameters in the client.
+            A ":name" parameter matches a non empty path segment and a "*" parameter matches the remaining path (it can be empty).
+            Unlike a plain route, a pattern must match the whole path */
+        static bool matchPattern(Client & client, const char * pattern, const std::size_t staticLength)
+        {
+            ROString path = client.getRequestedPath();
+            (void)path.splitAt((int)staticLength);
+            uint8 count = 0;
+            for (const char * p = pattern; *p;)
+            {
+                if (*p == '*')
+                {
+                    client.captures[count++] = path;
+                    path = ROString();
+                    break;
+                }
+                if (*p == ':')
+                {
+                    while (*p && *p != '/') p++;
+                    const std::size_t n = Scan::find<'/'>(path.getData(), (std::size_t)path.getLength());
+                    if (!n) return false;
+                    client.captures[count++] = path.splitAt((int)n);
+                    continue;
+                }
+                if (!path.getLength() || path[0] != *p) return false;
+                (void)path.splitAt(1);
+                p++;
+            }
+            if (path.getLength()) return false;
+            client.captureCount = count;
+            return true;
+        }
         /** An wildcard accepter that's only check the method, not the route */
         static bool accept(Client & client, uint32 methodsMask) { return ((1<<(uint32)client.reqLine.method) & methodsMask); }
 
@@ -100,7 +153,7 @@ namespace Network::Servers::HTTP
                 // Done, parsing? let's call the callback
                 if (input.midString(0, 2) == "\r\n")
                 {   // Skip to content directly for further processing if required
-                    client.recvBuffer.drop((std::size_t)((const uint8*)input.getData() - client.recvBuffer.getHead()) + 2);
+                    client.headersParsed((uint32)((const uint8*)input.getData() - client.recvBuffer.getHead()) + 2);
                     return ClientState::Processing;
                 }
 
@@ -121,13 +174,22 @@ namespace Network::Servers::HTTP
 
             do
             {
-                if (input.Find("\r\n") == input.getLength())
+                const std::size_t consumed = (std::size_t)((const uint8*)input.getData() - client.recvBuffer.getHead());
+                // The client's scanner already found the line endings, no need to search them again
+                if (!client.scanner.hasLine(consumed))
                 {
                     // Ok, we're done here, let's save the headers for the next iteration.
                     // Drop anything we've already processed to make space for later buffers
-                    client.recvBuffer.drop((std::size_t)((const uint8*)input.getData() - client.recvBuffer.getHead()));
+                    client.recvBuffer.drop(consumed);
+                    client.scanner.dropped(consumed);
                     return ClientState::NeedRefill;
                 }
+                // The previous headers might have been dropped before the final empty line was received
+                if (input.midString(0, 2) == "\r\n")
+                {
+                    client.headersParsed((uint32)consumed + 2);
+                    return ClientState::Processing;
+                }
                 if (ParsingError err = GenericHeaderParser::parseHeader(input, header); err != MoreData)
                     break;
 
@@ -158,18 +220,20 @@ namespace Network::Servers::HTTP
                     {
                         MaxPersistStringArray arr = {};
                         persist->getStringToPersist(arr);
-                        if (!Container::persistStrings(arr, client.recvBuffer, (std::size_t)((const uint8*)input.getData() - client.recvBuffer.getHead())))
+                        const std::size_t parsed = (std::size_t)((const uint8*)input.getData() - client.recvBuffer.getHead());
+                        if (!Container::persistStrings(arr, client.recvBuffer, parsed))
                         {
                             client.closeWithError(Code::InternalServerError);
                             return ClientState::Error;
                         }
+                        client.scanner.dropped(parsed);
                         input = client.recvBuffer.getView<ROString>();
                     }
                 }
                 // Done, parsing? let's call the callback
                 if (input.midString(0, 2) == "\r\n")
                 {   // Skip to content directly for further processing if required
-                    client.recvBuffer.drop((std::size_t)((const uint8*)input.getData() - client.recvBuffer.getHead()) + 2);
+                    client.headersParsed((uint32)((const uint8*)input.getData() - client.recvBuffer.getHead()) + 2);
                     return ClientState::Processing;
                 }
 
@@ -226,13 +290,32 @@ namespace Network::Servers::HTTP
         return state;
     }
 
-    /** A HTTP route that's accepted by this server. You'll define a list of routes with those in Router object declaration */
+    /** A HTTP route that's accepted by this server. You'll define a list of routes with those in Router object declaration.
+        The route's path is matched as a prefix of the requested path, unless it's a pattern with parameters: a ":name" parameter matches
+        a path segment and a "*" parameter (only at the end) matches the remaining path. A pattern must match the whole requested path and
+        its parameters are captured as views on the requested path, without any copy:
+        @code
+            constexpr auto sensor = [](Client & client, const auto &) { return client.reply(Code::Ok, client.getCapture(1)); };
+            constexpr Router<Route<sensor, MethodsMask{Method::GET}, "/api/device/:id/sensor/:name">{}> router;
+        @endcode */
     template <RouteCallback auto CallbackCRTP,  MethodsMask methods, CompileTime::str route, Headers ... allowedHeaders>
     struct Route final : public RouteHelper
     {
         typedef MakeHeadersArray<methods, allowedHeaders...>::Type ExpectedHeaderArray;
+        /** The route's path and methods, used by the router's dispatch tree */
+        static constexpr CompileTime::str path = route;
+        static constexpr MethodsMask allowedMethods = methods;
+        /** The length of the path's static part, before its first parameter if it's a pattern */
+        static constexpr std::size_t StaticLength = staticLength(route.data);
+        static_assert(countParameters(route.data) >= 0, "The '*' parameter must be the last part of the route's pattern");
+        static_assert(countParameters(route.data) <= MaxRouteCaptures, "Too many parameters in the route's pattern, increase MaxRouteCaptures");
+
         /** Early and fast check to see if the current request by the client is worth continuing parsing the headers */
-        static bool accept(Client & client) { return RouteHelper::accept(client, methods.mask, route.data, route.size); }
+        static bool accept(Client & client)
+        {
+            return RouteHelper::accept(client, methods.mask, route.data, StaticLength)
+                && (!route.data[StaticLength] || matchPattern(client, route.data + StaticLength, StaticLength));
+        }
 
         /** Once a route is accepted for a client, let's compute the list of headers and parse them all */
         static ClientState parse(Client & client) { return routeParse<CallbackCRTP, ExpectedHeaderArray>(client); }
@@ -264,21 +347,170 @@ namespace Network::Servers::HTTP
     /** The default route */
     template <RouteCallback auto CallbackCRTP, MethodsMask methods, Headers ... allowedHeaders> using DefaultRoute = Route<CallbackCRTP, methods, "", allowedHeaders...>;
 
-    /** Allow to compute the merge of all static routes in a single object */
+    /** A radix tree of the routes' paths, built at compile time, to find the routes with the longest prefix of a request's path.
+        Each node has a label (a part of the paths, stored in a pool) and the routes whose path ends there, in declaration order.
+        A node's children are contiguous and start with different bytes. Each node links to its closest ancestor with routes, so
+        the shorter prefixes are tried next, if the method doesn't match, without any stack.
+        @param RouteCount   The router's route count
+        @param PoolSize     The total length of the routes' paths */
+    template <std::size_t RouteCount, std::size_t PoolSize>
+    struct RouteTree
+    {
+        static constexpr uint16 NoNode = 0xFFFF;
+        struct Node
+        {
+            uint16 label = 0, labelLength = 0;
+            uint16 firstChild = 0, childCount = 0;
+            /** The routes ending here, in the order array */
+            uint16 firstRoute = 0, routeCount = 0;
+            /** The closest ancestor with routes */
+            uint16 fallback = NoNode;
+        };
+
+        char    pool[PoolSize ? PoolSize : 1];
+        Node    nodes[2 * RouteCount + 1];
+        /** The routes' indices, sorted by path (then the patterns first and the declaration order for the same path) */
+        uint16  order[RouteCount ? RouteCount : 1];
+        /** The static part of each route's path, in the pool */
+        uint16  offset[RouteCount ? RouteCount : 1], length[RouteCount ? RouteCount : 1];
+        bool    pattern[RouteCount ? RouteCount : 1];
+        uint16  nodeCount;
+
+        /** Build the tree from the routes' paths, nullptr for the routes that aren't matched by their path */
+        constexpr RouteTree(const char * const (&paths)[RouteCount ? RouteCount : 1]) : pool(), nodes(), order(), offset(), length(), pattern(), nodeCount(0)
+        {
+            std::size_t count = 0, used = 0;
+            for (std::size_t i = 0; i < RouteCount; i++)
+            {
+                if (!paths[i]) continue;
+                // Only the static part of a pattern is in the tree, the parameters are matched once its node is found
+                offset[i] = (uint16)used;
+                length[i] = (uint16)RouteHelper::staticLength(paths[i]);
+                pattern[i] = paths[i][length[i]] != 0;
+                for (std::size_t j = 0; j < length[i]; j++) pool[used++] = paths[i][j];
+                // Insertion sort, it's stable so the routes with the same path stay in declaration order
+                std::size_t j = count++;
+                for (; j && less(i, order[j - 1]); j--) order[j] = order[j - 1];
+                order[j] = (uint16)i;
+            }
+            if (count) { nodeCount = 1; build(0, 0, count, 0, NoNode); }
+        }
+
+        /** Find the deepest node with routes whose path is a prefix of the given path
+            @return The node's index or NoNode if none matches */
+        uint16 find(const ROString & path) const
+        {
+            if (!nodeCount) return NoNode;
+            const char * p = path.getData();
+            const std::size_t len = (std::size_t)path.getLength();
+            std::size_t pos = 0;
+            uint16 n = 0, best = NoNode;
+            while (true)
+            {
+                const Node & node = nodes[n];
+                if (len - pos < node.labelLength || memcmp(p + pos, &pool[node.label], node.labelLength)) break;
+                pos += node.labelLength;
+                if (node.routeCount) best = n;
+                if (pos == len) break;
+                uint16 c = 0;
+                while (c < node.childCount && pool[nodes[node.firstChild + c].label] != p[pos]) c++;
+                if (c == node.childCount) break;
+                n = (uint16)(node.firstChild + c);
+            }
+            return best;
+        }
+
+    private:
+        constexpr bool less(const std::size_t a, const std::size_t b) const
+        {
+            for (std::size_t i = 0; i < length[a] && i < length[b]; i++)
+                if (pool[offset[a] + i] != pool[offset[b] + i]) return (uint8)pool[offset[a] + i] < (uint8)pool[offset[b] + i];
+            return length[a] != length[b] ? length[a] < length[b] : pattern[a] && !pattern[b];
+        }
+        constexpr char at(const std::size_t r, const std::size_t i) const { return pool[offset[r] + i]; }
+
+        /** Build the given node for the sorted paths in [lo, hi), that all share their first depth bytes */
+        constexpr void build(const uint16 n, const std::size_t lo, const std::size_t hi, const std::size_t depth, const uint16 fallback)
+        {
+            // The common prefix of sorted paths is the one of the first and last path
+            const uint16 first = order[lo], last = order[hi - 1];
+            std::size_t common = depth;
+            while (common < length[first] && common < length[last] && at(first, common) == at(last, common)) common++;
+
+            Node & node = nodes[n];
+            node.label = (uint16)(offset[first] + depth);
+            node.labelLength = (uint16)(common - depth);
+            node.fallback = fallback;
+            // The shortest paths are sorted first, so the routes ending here are at the beginning of the range
+            std::size_t k = lo;
+            while (k < hi && length[order[k]] == common) k++;
+            node.firstRoute = (uint16)lo;
+            node.routeCount = (uint16)(k - lo);
+
+            // Then the children, one per distinct next byte
+            for (std::size_t i = k; i < hi; i++) if (i == k || at(order[i], common) != at(order[i - 1], common)) node.childCount++;
+            node.firstChild = nodeCount;
+            nodeCount += node.childCount;
+            const uint16 childFallback = node.routeCount ? n : fallback;
+            for (std::size_t i = k, c = 0; i < hi; c++)
+            {
+                std::size_t j = i + 1;
+                while (j < hi && at(order[j], common) == at(order[i], common)) j++;
+                build((uint16)(nodes[n].firstChild + c), i, j, common, childFallback);
+                i = j;
+            }
+        }
+    };
+
+    /** Allow to compute the merge of all static routes in a single object.
+        The routes with a path are dispatched with a radix tree built at compile time: the route with the longest path that's a prefix of
+        the request's path (and accepts its method) is selected, whatever the declaration order. The other routes (like the default route or
+        similar routes) are then tried in declaration order */
     template <auto ... Routes>
     struct Router
     {
         static constexpr auto routes = std::make_tuple(Routes...);
+        static constexpr std::size_t RouteCount = sizeof...(Routes);
+
+        template <typename R> static constexpr bool hasPath = requires { R::path; };
+        template <typename R> static constexpr const char * pathOf() { if constexpr (hasPath<R>) return R::path.data; else return nullptr; }
+        template <typename R> static constexpr uint32 methodsOf() { if constexpr (hasPath<R>) return R::allowedMethods.mask; else return 0; }
+        /** The route's parameters, after its static part, if it's a pattern */
+        template <typename R> static constexpr const char * patternOf() { if constexpr (hasPath<R>) { if (R::path.data[R::StaticLength]) return R::path.data + R::StaticLength; } return nullptr; }
+
+        static constexpr const char * paths[RouteCount ? RouteCount : 1] = { pathOf<std::decay_t<decltype(Routes)>>()... };
+        static constexpr const char * patterns[RouteCount ? RouteCount : 1] = { patternOf<std::decay_t<decltype(Routes)>>()... };
+        static constexpr uint32 methods[RouteCount ? RouteCount : 1] = { methodsOf<std::decay_t<decltype(Routes)>>()... };
+        typedef RouteTree<RouteCount, (RouteHelper::staticLength(pathOf<std::decay_t<decltype(Routes)>>()) + ... + 0)> Tree;
+        static constexpr Tree tree{paths};
+
         /** Accept a client and call the appropriate route accordingly */
         static ClientState process(Client & client) {
             // TODO: Read some data from the client to fetch, at least, the request line
             if (client.parsingStatus < Client::NeedRefillHeaders) return ClientState::Error;
 
-            // Usual trick to test all routes in a static type list
             ClientState ret = ClientState::Error;
+            auto dispatch = [&](const std::size_t route) {
+                return [&]<std::size_t... Is>(std::index_sequence<Is...>)  {
+                    return ((route == Is ? (ret = std::get<Is>(routes).parse(client), true) : false) || ...);
+                }(std::make_index_sequence<RouteCount>{});
+            };
+            // Longest matching path first, then the shorter ones if the method isn't accepted (or the pattern doesn't match)
+            const uint32 method = 1U << (uint32)client.reqLine.method;
+            for (uint16 n = tree.find(client.reqLine.URI.absolutePath); n != Tree::NoNode; n = tree.nodes[n].fallback)
+            {
+                const typename Tree::Node & node = tree.nodes[n];
+                for (uint16 i = node.firstRoute; i < node.firstRoute + node.routeCount; i++)
+                {
+                    const uint16 r = tree.order[i];
+                    if ((methods[r] & method) && (!patterns[r] || RouteHelper::matchPattern(client, patterns[r], tree.length[r])) && dispatch(r)) return ret;
+                }
+            }
+
+            // Usual trick to test all other routes in a static type list
             bool handled = [&]<std::size_t... Is>(std::index_sequence<Is...>)  {
-                return ( (std::get<Is>(routes).accept(client) ? (ret = std::get<Is>(routes).parse(client), true) : false) || ... );
-            }(std::make_index_sequence<sizeof...(Routes)>{});
+                return ( (!hasPath<std::decay_t<decltype(std::get<Is>(routes))>> && std::get<Is>(routes).accept(client) ? (ret = std::get<Is>(routes).parse(client), true) : false) || ... );
+            }(std::make_index_sequence<RouteCount>{});
 
             if (!handled) { client.closeWithError(Code::NotFound); return ClientState::Error; }
             return ret;
@@ -302,6 +534,12 @@ namespace Network::Servers::HTTP
         Socket server;
         /** The socket pool for passively monitoring sockets */
         SocketPool<MaxClientCount + 1> pool;
+        /** The timers for each client's timeouts */
+        Container::TimerWheel<MaxClientCount> timers;
+        /** The phase each client's timer is armed for */
+        uint8 timerPhases[MaxClientCount] = {};
+        /** The Date and Server headers sent with every answer */
+        CommonHeaders commonHeaders;
         /** The cookie jar for each session */
         //TODO
 
@@ -314,16 +552,194 @@ namespace Network::Servers::HTTP
             return Success;
         }
 
+        /** Close a client that was accepted but can't be monitored by the pool (like a descriptor above select's limit), so its slot is free again */
+        void rejectClient(Client & client)
+        {
+#if UseTLSServer == 0
+            client.socket.send(UnavailableAnswer, sizeof(UnavailableAnswer) - 1);
+#endif
+            SLog(Level::Warning, "Client %s rejected: %d", client.socket.address, 503);
+            client.closed();
+        }
+
+        /** Deal with an error while accepting a connection.
+            Only a failing listening socket is reported to the caller, a connection that can't be accepted right now stays in the backlog */
+        Error acceptFailed(const Error ret)
+        {
+            if (ret == WouldBlock) return Success;
+            if (ret == OutOfResources)
+            {   // Stop accepting for this loop, the clients being closed meanwhile will release some descriptors
+                SLog(Level::Warning, "Can't accept a client: out of resources");
+                return Success;
+            }
+            return ret;
+        }
+
+#if BatchAccept == 1
+        /** Check if there's still a pending connection on the server socket */
+        bool hasPendingConnection()
+        {
+#if LinuxHost == 1
+            // The server socket is non blocking here, so accept will tell us
+            return true;
+#else
+            return server.select(true, false, 0).getCount() > 0;
+#endif
+        }
+
+        /** Accept all pending connections.
+            Since the clients are accepted in the order of the array, the search for a free slot restarts where it stopped */
+        Error acceptAll()
+        {
+            std::size_t i = 0;
+            for (bool first = true; first || hasPendingConnection(); first = false)
+            {
+                // Find the position for a free client in the array
+                while (i < MaxClientCount && clientsArray[i].isValid()) i++;
+                if (i == MaxClientCount)
+                {   // No more slot available, so reject the connection instead of letting it wait in the backlog
+                    BaseSocket rejected;
+                    Error ret = server.BaseSocket::accept(rejected, 0);
+                    if (ret == Aborted) continue;
+                    if (ret.isError()) return acceptFailed(ret);
+#if UseTLSServer == 0
+                    rejected.send(UnavailableAnswer, sizeof(UnavailableAnswer) - 1);
+#endif
+                    SLog(Level::Warning, "Client %s rejected: %d", rejected.address, 503);
+                    continue;
+                }
+
+                Error ret = server.accept(clientsArray[i].socket, 0);
+                if (ret == Aborted) continue;
+                if (ret == SSLHandshake) { clientsArray[i].closed(); continue; }
+                if (ret.isError()) return acceptFailed(ret);
+
+                // Client was received, so let's add this to the loop
+                if (!pool.append(clientsArray[i].socket)) { rejectClient(clientsArray[i]); continue; }
+
+                clientsArray[i].accepted(&commonHeaders);
+                updateTimer(&clientsArray[i]);
+            }
+            return Success;
+        }
+#endif
+
+        /** The phase a client's timer is armed for */
+        enum TimerPhase
+        {
+            NoTimer = 0,
+            IdlePhase,      //!< Waiting for a new request on a kept alive connection
+            HeaderPhase,    //!< Receiving the request line and headers
+            BodyPhase,      //!< Receiving the request body
+            SendingPhase,   //!< Sending an answer asynchronously
+        };
+
+        /** Arm (or disarm) the client's timer depending on its state.
+            A timer is only rearmed when the client enters a new phase, makes progress while sending an answer or got a request answered,
+            so a client trickling its request byte by byte can't extend its own deadline
+            @param answered     Set if a request was answered since the last update, so the next phase (like waiting for the next request
+                                on a kept alive connection) gets a new deadline even if it's the same phase */
+        void updateTimer(Client * client, const bool answered = false)
+        {
+            std::size_t i = (std::size_t)(client - clientsArray);
+            uint8 phase = !client->isValid() ? NoTimer : client->hasPendingOutput() ? SendingPhase
+                        : client->parsingStatus == Client::Invalid ? IdlePhase
+                        : client->parsingStatus < Client::HeadersDone ? HeaderPhase : BodyPhase;
+            if (phase == timerPhases[i] && phase != SendingPhase && !answered) return;
+            timerPhases[i] = phase;
+            switch (phase)
+            {
+            case NoTimer:       timers.cancel(i); break;
+            case IdlePhase:     timers.schedule(i, KeepAliveTimeoutMs); break;
+            case HeaderPhase:   timers.schedule(i, HeaderReadTimeoutMs); break;
+            default:            timers.schedule(i, BodyTimeoutMs); break;
+            }
+        }
+
+        /** Process the activity on the given client's socket
+            @return true if a request was completely answered */
+        bool processClient(Client * client)
+        {
+            if (client->hasPendingOutput())
+            {   // The socket is writable again, continue sending the answer
+                if (!client->resumeSending()) { client->closed(); pool.remove(client->socket); return false; }
+                if (client->hasPendingOutput()) return false;
+                // Done, so monitor the socket for reading again (if it's kept alive)
+                if (!client->keepAlive) { pool.remove(client->socket); return true; }
+                pool.watchForWriting(client->socket, false);
+                // Process any pipelined request received meanwhile
+                if (client->recvBuffer.getSize()) processRequests(client);
+                return true;
+            }
+
+            // Check if we can fill the receive buffer first
+            uint32 availableLength = client->recvBuffer.freeSize();
+            if (!availableLength)
+            {
+                closeClient(client, Code::EntityTooLarge);
+                return false;
+            }
+            Error ret = client->socket.recv((char*)client->recvBuffer.getTail(), availableLength);
+            if (ret.isError())
+            {
+                closeClient(client, Code::BadRequest);
+                return false;
+            }
+            // Check if the client remotely closed meanwhile
+            if (!ret.getCount()) { client->closed(); pool.remove(client->socket); return false; }
+            client->recvBuffer.stored(ret.getCount());
+
+            return processRequests(client);
+        }
+
+        /** Parse and route the requests in the client's buffer.
+            If the client pipelines its requests, the next request is processed right away, without waiting for the socket to be readable
+            @return true if a request was completely answered */
+        bool processRequests(Client * client)
+        {
+            bool answered = false;
+            while (true)
+            {
+                // Then parse the client code here at best as we can
+                if (!client->parse()) { closeClient(client); return answered; }
+                // Check if we can query the routes now
+                if (client->parsingStatus <= Client::RecvHeaders) return answered;
+
+                // Yes we can, trigger the router with them
+                switch (Router.process(*client))
+                {
+                case ClientState::Error:
+                case ClientState::Done:
+                    // The answer wasn't sent completely, so wait for the socket to be writable to continue
+                    if (client->hasPendingOutput()) { pool.watchForWriting(client->socket, true); return answered; }
+                    else if (!client->keepAlive) { pool.remove(client->socket); return true; }
+                    answered = true;
+                break;
+                // Don't remove the client from the pool in that case, let's simply continue later on
+                case ClientState::Processing: return answered;
+                case ClientState::NeedRefill: return answered;
+                }
+                // Continue with the next request only if the previous one was completely answered
+                if (client->parsingStatus != Client::Invalid || !client->recvBuffer.getSize()) return answered;
+            }
+        }
+
         /** The main server loop */
         Error loop(uint32 timeoutMs = 20)
         {
             // Kill any lingering client if any
-            for (auto i = 0; i < MaxClientCount; i++)
-            {
-                if (clientsArray[i].tickTimeToLive()) pool.remove(clientsArray[i].socket);
-            }
+            timers.advance(Container::getMonotonicTimeMs(), [this](std::size_t i) {
+                Client & client = clientsArray[i];
+                timerPhases[i] = NoTimer;
+                if (!client.isValid()) return;
+                SLog(Level::Info, "Client %s timed out", client.socket.address);
+                client.closed();
+                pool.remove(client.socket);
+            });
+
             if (pool.selectActive(timeoutMs) == Success)
             {   // At least, one socket made progress, so deal with it
+                commonHeaders.refresh(time(nullptr));
 
                 // Deal with client socket first
                 Socket * socket;
@@ -331,62 +747,34 @@ namespace Network::Servers::HTTP
                 {
                     // Got a client for a socket, so need to fill the client buffer and let it progress parsing
                     Client * client = (Client*)(socket); // The address of the first member of a struct is the same as the struct itself //container_of(socket, ClientBase, socket));
-
-                    // Check if we can fill the receive buffer first
-                    uint32 availableLength = client->recvBuffer.freeSize();
-                    if (!availableLength)
-                    {
-                        closeClient(client, Code::EntityTooLarge);
-                        continue;
-                    }
-                    Error ret = client->socket.recv((char*)client->recvBuffer.getTail(), availableLength);
-                    if (ret.isError())
-                    {
-                        closeClient(client, Code::BadRequest);
-                        continue;
-                    }
-                    // Check if the client remotely closed meanwhile
-                    if (!ret.getCount()) { client->closed(); pool.remove(client->socket); break; }
-                    client->recvBuffer.stored(ret.getCount());
-
-                    // Then parse the client code here at best as we can
-                    if (!client->parse()) closeClient(client);
-                    else {
-                        // Check if we can query the routes now
-                        if (client->parsingStatus > Client::RecvHeaders)
-                        {   // Yes we can, trigger the router with them
-                            switch (Router.process(*client))
-                            {
-                            case ClientState::Error:
-                            case ClientState::Done:
-                                if (!client->timeToLive) { pool.remove(client->socket); }
-                            break;
-                            // Don't remove the client from the pool in that case, let's simply continue later on
-                            case ClientState::Processing: break;
-                            case ClientState::NeedRefill: break;
-                            }
-                        }
-                    }
+                    updateTimer(client, processClient(client));
                 }
 
                 if (pool.isReadable(0))
                 {   // The server socket is active, let's check if we have any client to process
+#if BatchAccept == 1
+                    return acceptAll();
+#else
                     // Find the position for a free client in the array
                     for (auto i = 0; i < ArrSz(clientsArray); i++)
                         if (!clientsArray[i].isValid())
                         {
                             Error ret = server.accept(clientsArray[i].socket, 0);
-                            if (ret.isError()) return ret;
+                            if (ret == Aborted) break;
+                            if (ret == SSLHandshake) { clientsArray[i].closed(); break; }
+                            if (ret.isError()) return acceptFailed(ret);
 
                             // Client was received, so let's add this to the loop
-                            if (!pool.append(clientsArray[i].socket)) return AllocationFailure;
+                            if (!pool.append(clientsArray[i].socket)) { rejectClient(clientsArray[i]); break; }
 
-                            clientsArray[i].accepted();
+                            clientsArray[i].accepted(&commonHeaders);
+                            updateTimer(&clientsArray[i]);
                             break;
                         }
 
                     // None found, it'll be processed on the next loop anyway
                     return Success;
+#endif
                 }
             }
 
@@ -395,10 +783,18 @@ namespace Network::Servers::HTTP
 
         Server() {}
 
-        Error create(uint16 port)
+        /** Create the server's listening socket
+            @param port         The port to listen on
+            @param shareable    If true, other servers can listen on the same port (see ShardedServer) */
+        Error create(uint16 port, bool shareable = false)
         {
-            if (Error ret = server.listen(port, MaxClientCount); ret.isError())
+            if (Error ret = server.listen(port, MaxClientCount, shareable); ret.isError())
+                return ret;
+#if BatchAccept == 1 && LinuxHost == 1
+            // Accept until the backlog is empty
+            if (Error ret = server.setBlocking(false); ret.isError())
                 return ret;
+#endif
 
             if (!pool.append(server)) return AllocationFailure;
             SLog(Level::Info, "HTTP server listening on port %u", (unsigned)port);
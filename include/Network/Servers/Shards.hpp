@@ -0,0 +1,136 @@
+#ifndef hpp_Shards_hpp
+#define hpp_Shards_hpp
+
+// We need the server declaration
+#include "Route.hpp"
+
+// We need threads and atomic here
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#if LinuxHost == 1
+  // We need pthread_setaffinity_np
+  #include <pthread.h>
+  #include <sched.h>
+#elif defined(ESP_PLATFORM)
+  // Threads are pinned to a core via the pthread configuration
+  #include "esp_pthread.h"
+#endif
+
+namespace Network::Servers::HTTP
+{
+    /** A server made of multiple independent servers (called shards), each running in its own thread.
+        Each shard has its own listening socket, bound on the same port with SO_REUSEPORT, so the kernel balances the incoming
+        connections between them. Shards don't share anything (no client array, no pool), so there's no locking involved.
+
+        Usage is like this:
+        @code
+            static ShardedServer<router, 64, 4> server; // Large object, don't put it on the stack
+            if (server.create(80).isError()) return;
+            server.start();
+            // [...]
+            server.stop();
+        @endcode
+
+        @warning The routes' callbacks are called from multiple threads, so they must be thread safe if they share any state
+        @warning lwIP doesn't implement SO_REUSEPORT, so on ESP-IDF only one shard can listen on a port */
+    template <auto Router, std::size_t MaxClientCount = 4, std::size_t ShardCount = 2>
+    struct ShardedServer
+    {
+#if defined(ESP_PLATFORM) && LinuxHost == 0
+        static_assert(ShardCount == 1, "lwIP doesn't implement SO_REUSEPORT, so the shards can't share the listening port on ESP-IDF");
+#endif
+        /** The shards themselves */
+        Server<Router, MaxClientCount> shards[ShardCount];
+        /** The worker threads */
+        std::thread workers[ShardCount];
+        /** Whether the workers should continue to run */
+        std::atomic<bool> running;
+        /** The maximum delay between 2 loops of a shard whose loop keeps failing */
+        static constexpr uint32 MaxBackoffMs = 1000;
+
+        /** Create all the shards' listening sockets on the given port */
+        Error create(uint16 port)
+        {
+            for (std::size_t i = 0; i < ShardCount; i++)
+                if (Error ret = shards[i].create(port, true); ret.isError()) return ret;
+            return Success;
+        }
+
+        /** Start the worker threads
+            @param pinToCore    If true, each shard is pinned to a CPU core (shard i is running on core i modulo the core count)
+            @param timeoutMs    The timeout for each shard's loop */
+        Error start(bool pinToCore = true, uint32 timeoutMs = 20)
+        {
+            if (running.exchange(true)) return Success;
+            const std::size_t coreCount = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+#if defined(ESP_PLATFORM) && LinuxHost == 0
+            // The pthread configuration is process wide, so restore it once the workers are created
+            esp_pthread_cfg_t previous;
+            const bool hadConfig = esp_pthread_get_cfg(&previous) == ESP_OK;
+#endif
+            for (std::size_t i = 0; i < ShardCount; i++)
+            {
+#if defined(ESP_PLATFORM) && LinuxHost == 0
+                if (pinToCore)
+                {
+                    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+                    cfg.pin_to_core = (int)(i % coreCount);
+                    esp_pthread_set_cfg(&cfg);
+                }
+#endif
+                workers[i] = std::thread([this, i, timeoutMs]() {
+                    // The loop only fails on a listening socket's error (a connection that can't be accepted is dealt with in the loop).
+                    // Back off while the listening socket keeps failing instead of spinning and flooding the log
+                    uint32 backoffMs = 0;
+                    while (running.load(std::memory_order_relaxed))
+                    {
+                        Error ret = shards[i].loop(timeoutMs);
+                        if (!ret.isError()) { backoffMs = 0; continue; }
+                        if (ret != Accept) { SLog(Level::Warning, "Shard %u loop failed: %d", (unsigned)i, (int)ret); continue; }
+                        if (!backoffMs) SLog(Level::Error, "Shard %u listening socket failed: %d", (unsigned)i, (int)ret);
+                        backoffMs = !backoffMs ? 1 : backoffMs * 2 < MaxBackoffMs ? backoffMs * 2 : MaxBackoffMs;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+                    }
+                });
+#if LinuxHost == 1
+                if (pinToCore)
+                {
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(i % coreCount, &set);
+                    if (::pthread_setaffinity_np(workers[i].native_handle(), sizeof(set), &set) != 0)
+                        SLog(Level::Warning, "Can't set shard %u affinity", (unsigned)i);
+                }
+#endif
+            }
+#if defined(ESP_PLATFORM) && LinuxHost == 0
+            if (pinToCore)
+            {
+                if (hadConfig) esp_pthread_set_cfg(&previous);
+                else
+                {
+                    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+                    esp_pthread_set_cfg(&cfg);
+                }
+            }
+#endif
+            SLog(Level::Info, "HTTP server started with %u shards", (unsigned)ShardCount);
+            return Success;
+        }
+
+        /** Stop the worker threads and wait for them to finish */
+        void stop()
+        {
+            running = false;
+            for (std::size_t i = 0; i < ShardCount; i++)
+                if (workers[i].joinable()) workers[i].join();
+        }
+
+        ShardedServer() : running(false) {}
+        ~ShardedServer() { stop(); }
+    };
+}
+
+#endif
@@ -13,14 +13,25 @@
 #include <sys/select.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <errno.h>
+#if LinuxHost == 1
+  // We need iovec
+  #include <sys/uio.h>
+  // We need sendfile
+  #include <sys/sendfile.h>
+#endif
 // We need TCP_NODELAY
 #include <netinet/tcp.h>
 // We need sockaddr_in
 #include <netinet/in.h>
+// We need fcntl for non blocking sockets
+#include <fcntl.h>
 #if BuildClient == 1
-  #include <fcntl.h>
   #include <netdb.h>
 #endif
+#if UseEpoll == 1
+  #include <sys/epoll.h>
+#endif
 
 #if UseTLS == 1
 // We need MBedTLS code
@@ -55,15 +66,54 @@ namespace Network {
                          (suseconds_t)((timeout & 1023) * 977)};  // Avoid modulo here and make sure it doesn't overflow (since 1023 * 977 < 1000000)
     }
 
+    struct BaseSocket;
+    /** A send batch, used to coalesce many small sends in a single system call.
+        While the batch is alive, any send on the socket is copied in the given buffer. When a send doesn't fit,
+        the buffer and the data to send are sent at once (scatter-gather). The buffer must be flushed before the batch is destructed */
+    struct SendBatch
+    {
+        BaseSocket &    socket;
+        uint8 *         buffer;
+        uint32          size;
+        uint32          used;
+
+        /** Get the free space in the batch buffer. Data written there can be appended without copying */
+        inline uint8 * getTail() { return &buffer[used]; }
+        inline uint32 freeSize() const { return size - used; }
+
+        /** Append the given data to the batch, or send it along with the batch's content if it doesn't fit
+            @return the length appended or an error */
+        inline Error append(const char * data, const uint32 length);
+        /** Send the batch's content now */
+        inline Error flush();
+        /** Send the batch's content and detach from the socket (next sends aren't batched anymore) */
+        inline Error done() { Error ret = flush(); detach(); return ret; }
+        /** Detach from the socket */
+        inline void detach();
+
+        inline SendBatch(BaseSocket & socket, uint8 * buffer, const uint32 size);
+        inline ~SendBatch();
+    };
+
     /** The base socket that's used in the server, using plain old IPv4 and no specific code */
     struct BaseSocket
     {
         int                      socket;
         char                     address[IPV4StrAddressLen];
+        /** The batch the sends are coalesced into, if any */
+        SendBatch *              batch;
+#if LinuxHost == 1
+        /** Whether sendFile left the socket in non blocking mode */
+        bool                     nonBlocking = false;
+#endif
 
         /** Start listening on the socket
+            @param port             The port to listen on
+            @param maxClientCount   The listen backlog size
+            @param shareable        If true, multiple sockets can listen on the same port (with SO_REUSEPORT) and
+                                    the kernel will balance the incoming connections between them
             @return 0 on success, negative value upon error */
-        Virtual Error listen(uint16 port, int maxClientCount = 1)
+        Virtual Error listen(uint16 port, int maxClientCount = 1, bool shareable = false)
         {
             socket = ::socket(AF_INET, SOCK_STREAM, 0);
             if (socket == -1) return SocketCreation;
@@ -71,6 +121,14 @@ namespace Network {
             // Make sure we can bind on an already bound address
             int n = 1;
             if (::setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, (const char *) &n, sizeof(n)) != 0) return SocketOption;
+            if (shareable)
+            {
+#ifdef SO_REUSEPORT
+                if (::setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, (const char *) &n, sizeof(n)) != 0) return SocketOption;
+#else
+                return SocketOption;
+#endif
+            }
 
             struct sockaddr_in address;
             address.sin_port = htons(port);
@@ -147,6 +205,22 @@ namespace Network {
 
         /** Accept a new client.
             @return 0 on success, negative value upon error */
+        /** Convert the accept's errno to an error. Only Accept means that the listening socket itself is failing */
+        static Error acceptError()
+        {
+            switch (errno)
+            {
+            case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+            case EWOULDBLOCK:
+#endif
+                return WouldBlock;
+            case ECONNABORTED: case EINTR: case EPROTO: return Aborted;
+            case EMFILE: case ENFILE: case ENOBUFS: case ENOMEM: return OutOfResources;
+            default: return Accept;
+            }
+        }
+
         Virtual Error accept(BaseSocket & clientSocket, const uint32 timeoutMillis = 0)
         {
             // Check for activity on the socket
@@ -156,8 +230,13 @@ namespace Network {
 
             struct sockaddr_in clientAddress = {};
             socklen_t addrLen = sizeof(clientAddress);
+#if LinuxHost == 1
+            // Don't leak the client's socket to any child process, and avoid a fcntl call for this
+            int ret = ::accept4(socket, (sockaddr*)&clientAddress, &addrLen, SOCK_CLOEXEC);
+#else
             int ret = ::accept(socket, (sockaddr*)&clientAddress, &addrLen);
-            if (ret == -1) return Accept;
+#endif
+            if (ret == -1) return acceptError();
 
             clientSocket.socket = ret;
             sprintf(clientSocket.address, "%u.%u.%u.%u:%u", (unsigned)((clientAddress.sin_addr.s_addr >> 0) & 0xFF), (unsigned)((clientAddress.sin_addr.s_addr >> 8) & 0xFF), (unsigned)((clientAddress.sin_addr.s_addr >> 16) & 0xFF), (unsigned)((clientAddress.sin_addr.s_addr >> 24) & 0xFF), (unsigned)clientAddress.sin_port);
@@ -166,6 +245,9 @@ namespace Network {
 
         Virtual Error recv(char * buffer, const uint32 maxLength = 0, const uint32 minLength = 0)
         {
+#if LinuxHost == 1
+            restoreBlocking();
+#endif
             int ret = 0;
             if (minLength) {
                 ret = ::recv(socket, buffer, minLength, MSG_WAITALL);
@@ -178,10 +260,108 @@ namespace Network {
 
         Virtual Error send(const char * buffer, const uint32 length)
         {
+            if (batch) return batch->append(buffer, length);
+#if LinuxHost == 1
+            restoreBlocking();
+#endif
             return ::send(socket, buffer, (int)length, 0);
         }
 
+#if LinuxHost == 1
+        /** Send a file's content directly from the kernel (zero copy), without blocking. This isn't available for TLS socket.
+            @param fd       The file descriptor to read from
+            @param offset   The offset in the file to start from, it's updated with the sent size
+            @param length   The number of bytes to send
+            @return Success if everything was sent, WouldBlock if the socket's buffer is full (check the offset to know what was sent) or any error */
+        Error sendFile(const int fd, off_t & offset, std::size_t length)
+        {
+            // sendfile has no flag to avoid blocking, so the socket is switched to non blocking mode. It's left in that mode until a
+            // blocking call is made, so resuming a parked answer doesn't cost any mode change
+            if (!nonBlocking)
+            {   // Linux only changes the status flags with F_SETFL and the socket doesn't have any, so there's no need to fetch them first
+                if (::fcntl(socket, F_SETFL, O_NONBLOCK) != 0) return SocketOption;
+                nonBlocking = true;
+            }
+            while (length)
+            {
+                ssize_t sent = ::sendfile(socket, fd, &offset, length);
+                if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? WouldBlock : Sending;
+                // The file was truncated meanwhile
+                if (sent == 0) return Sending;
+                length -= (std::size_t)sent;
+            }
+            return Success;
+        }
+
+        /** Restore the blocking mode, if sendFile left the socket in non blocking mode */
+        void restoreBlocking() { if (nonBlocking && ::fcntl(socket, F_SETFL, 0) == 0) nonBlocking = false; }
+#endif
+
+        /** Send multiple buffers at once (scatter-gather)
+            @param vec      The buffers to send, this array is modified while sending
+            @param count    The number of buffers
+            @return the number of bytes sent or an error */
+        Virtual Error sendv(struct iovec * vec, int count)
+        {
+#if LinuxHost == 1
+            restoreBlocking();
+#endif
+            int total = 0;
+            while (count)
+            {
+                struct msghdr msg = {};
+                msg.msg_iov = vec;
+                msg.msg_iovlen = count;
+                int ret = (int)::sendmsg(socket, &msg, 0);
+                if (ret < 0) return Sending;
+                total += ret;
+                // Skip what was sent and continue with the remaining data
+                while (count && (std::size_t)ret >= vec->iov_len) { ret -= (int)vec->iov_len; vec++; count--; }
+                if (count) { vec->iov_base = (char*)vec->iov_base + ret; vec->iov_len -= (std::size_t)ret; }
+            }
+            return total;
+        }
+
+        /** Send without blocking, only the part that fits in the socket's buffer is sent.
+            @return the number of bytes sent, WouldBlock if none could be sent or any error upon failure */
+        Error sendNonBlocking(const char * buffer, const uint32 length)
+        {
+            int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+            flags |= MSG_NOSIGNAL;
+#endif
+            int ret = ::send(socket, buffer, (int)length, flags);
+            if (ret < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? WouldBlock : Sending;
+            return ret;
+        }
+
+        /** Send multiple buffers at once (scatter-gather) without blocking, only the part that fits in the socket's buffer is sent.
+            This isn't available for TLS socket.
+            @return the number of bytes sent, WouldBlock if none could be sent or any error upon failure */
+        Error sendvNonBlocking(struct iovec * vec, int count)
+        {
+            int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+            flags |= MSG_NOSIGNAL;
+#endif
+            struct msghdr msg = {};
+            msg.msg_iov = vec;
+            msg.msg_iovlen = count;
+            int ret = (int)::sendmsg(socket, &msg, flags);
+            if (ret < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? WouldBlock : Sending;
+            return ret;
+        }
+
         // Useful socket helpers functions here
+        /** Set the socket in blocking or non blocking mode */
+        Error setBlocking(bool blocking)
+        {
+            int socketFlags = ::fcntl(socket, F_GETFL, 0);
+            if (socketFlags == -1) return SocketOption;
+            if (::fcntl(socket, F_SETFL, blocking ? (socketFlags & ~O_NONBLOCK) : (socketFlags | O_NONBLOCK)) != 0) return SocketOption;
+            return Success;
+        }
+
         Virtual Error select(bool reading, bool writing, const uint32 timeoutMillis = (uint32)-1)
         {
             // Linux modifies the timeout when calling select
@@ -200,16 +380,45 @@ namespace Network {
         /** This is only used with SSL socket to avoid RTTI */
         Virtual int getType() const { return 0; }
 
+#if LinuxHost == 1
+        Virtual void reset() { ::closesocket(socket); socket = -1; nonBlocking = false; }
+#else
         Virtual void reset() { ::closesocket(socket); socket = -1; }
+#endif
 
         bool isValid() const { return socket != -1; }
 
-        BaseSocket() : socket(-1) {}
+        BaseSocket() : socket(-1), batch(nullptr) {}
         Virtual ~BaseSocket() { ::closesocket(socket); socket = -1; }
     };
 
 #undef Virtual
 
+    Error SendBatch::append(const char * data, const uint32 length)
+    {
+        // Already written in the batch's buffer
+        if ((const uint8*)data == getTail() && length <= freeSize()) { used += length; return (int)length; }
+        if (length <= freeSize()) { memcpy(getTail(), data, length); used += length; return (int)length; }
+        // Doesn't fit, so send both now
+        struct iovec vec[2] = { { buffer, used }, { const_cast<char*>(data), length } };
+        int count = used ? 2 : 1;
+        Error ret = socket.sendv(used ? vec : &vec[1], count);
+        if (ret.isError()) return ret;
+        used = 0;
+        return (int)length;
+    }
+    Error SendBatch::flush()
+    {
+        if (!used) return Success;
+        struct iovec vec = { buffer, used };
+        used = 0;
+        Error ret = socket.sendv(&vec, 1);
+        return ret.isError() ? ret : Error(Success);
+    }
+    SendBatch::SendBatch(BaseSocket & socket, uint8 * buffer, const uint32 size) : socket(socket), buffer(buffer), size(size), used(0) { socket.batch = this; }
+    void SendBatch::detach() { if (socket.batch == this) socket.batch = nullptr; }
+    SendBatch::~SendBatch() { detach(); }
+
 #if UseTLS == 1
     class MBTLSSocket : public BaseSocket
     {
@@ -277,6 +486,33 @@ namespace Network {
             return Success;
         }
 
+        /** The TLS engine's send function that doesn't block */
+        static int sendDontWait(void * context, const unsigned char * buffer, size_t length)
+        {
+            int flags = MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+            flags |= MSG_NOSIGNAL;
+#endif
+            int ret = (int)::send(((mbedtls_net_context*)context)->fd, buffer, length, flags);
+            if (ret < 0) return errno == EAGAIN || errno == EWOULDBLOCK ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+            return ret;
+        }
+
+        /** Write the whole buffer, since mbedtls_ssl_write can write less than asked (it's limited to a record's size) or ask to be called again
+            @return the buffer's length on success, or the TLS engine's negative error code */
+        int writeAll(const uint8 * buffer, const uint32 length)
+        {
+            uint32 sent = 0;
+            while (sent < length)
+            {
+                int ret = ::mbedtls_ssl_write(&ssl, buffer + sent, length - sent);
+                if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) continue;
+                if (ret < 0) return ret;
+                sent += (uint32)ret;
+            }
+            return (int)sent;
+        }
+
     public:
         MBTLSSocket() : BaseSocket()
         {
@@ -289,9 +525,9 @@ namespace Network {
             mbedtls_pk_init(&pk);
         }
 
-        Error listen(uint16 port, int maxClientCount = 1)
+        Error listen(uint16 port, int maxClientCount = 1, bool shareable = false)
         {
-            Error ret = BaseSocket::listen(port, maxClientCount);
+            Error ret = BaseSocket::listen(port, maxClientCount, shareable);
             if (ret.isError()) return ret;
 
             net.fd = socket;
@@ -356,7 +592,8 @@ namespace Network {
             socklen_t addrLen = sizeof(clientAddress);
             size_t clientAddrLen = 0;
             int ret = mbedtls_net_accept(&net, &client.net, &clientAddress, addrLen, &clientAddrLen);
-            if (ret != 0) return Accept;
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ) return WouldBlock;
+            if (ret != 0) return acceptError();
 
             sprintf(clientSocket.address, "%u.%u.%u.%u:%u", (unsigned)((clientAddress.sin_addr.s_addr >> 0) & 0xFF), (unsigned)((clientAddress.sin_addr.s_addr >> 8) & 0xFF), (unsigned)((clientAddress.sin_addr.s_addr >> 16) & 0xFF), (unsigned)((clientAddress.sin_addr.s_addr >> 24) & 0xFF), (unsigned)clientAddress.sin_port);
             clientSocket.socket = client.net.fd; // Also save the file descriptor here
@@ -375,7 +612,34 @@ namespace Network {
 
         Error send(const char * buffer, const uint32 length)
         {
-            return ::mbedtls_ssl_write(&ssl, (const uint8*)buffer, length);
+            if (batch) return batch->append(buffer, length);
+            return writeAll((const uint8*)buffer, length);
+        }
+
+        /** Send without blocking, only the records that fit in the socket's buffer are sent.
+            If WouldBlock is returned, the TLS engine keeps the pending record, so the next call must be made with the same buffer and length
+            @return the number of bytes sent, WouldBlock if none could be sent or any error upon failure */
+        Error sendNonBlocking(const char * buffer, const uint32 length)
+        {
+            // Only this call must not block, so use a non blocking send function for it
+            ::mbedtls_ssl_set_bio(&ssl, &net, sendDontWait, ::mbedtls_net_recv, NULL);
+            int ret = ::mbedtls_ssl_write(&ssl, (const uint8*)buffer, length);
+            ::mbedtls_ssl_set_bio(&ssl, &net, ::mbedtls_net_send, ::mbedtls_net_recv, NULL);
+            if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) return WouldBlock;
+            return ret < 0 ? Error(Sending) : Error(ret);
+        }
+
+        /** There's no scatter-gather in TLS, so send each buffer in turn (the batch has coalesced the small ones already) */
+        Error sendv(struct iovec * vec, int count)
+        {
+            int total = 0;
+            for (int i = 0; i < count; i++)
+            {
+                int ret = writeAll((const uint8*)vec[i].iov_base, (uint32)vec[i].iov_len);
+                if (ret < 0) return ret;
+                total += ret;
+            }
+            return total;
         }
 
         Error recv(char * buffer, const uint32 maxLength = 0, const uint32 minLength = 0)
@@ -422,6 +686,130 @@ namespace Network {
     };
 #endif
 
+#if UseEpoll == 1
+    /** A socket pool used to monitor multiple socket at once, using Linux's epoll.
+        It's the same interface as the select based pool below, but the kernel keeps the monitored set so
+        the cost of each loop is only proportional to the number of active sockets, not the registered ones.
+        The order of the sockets in the pool isn't preserved upon removing sockets (removing is done with swapping with the last used element in the array).
+        Appending sockets are always done to the end of the pool.  */
+    template <std::size_t N>
+    struct SocketPool
+    {
+        BaseSocket *        sockets[N] = {};
+        std::size_t         used = 0;
+        /** The epoll instance */
+        int                 epollFD;
+        /** The events reported by the last call to selectActive. The data contains the socket's position in the pool */
+        struct epoll_event  events[N];
+        /** The number of events in the array above */
+        int                 readyCount;
+        /** The sockets that are monitored for writing instead of reading, one bit per socket position */
+        uint32              writeMask[(N + 31) / 32];
+
+        static constexpr uint32 Consumed = (uint32)-1;
+
+        /** Bit manipulation helpers for the mask above */
+        static inline bool hasBit(const uint32 * mask, std::size_t pos) { return mask[pos / 32] & (1U << (pos % 32)); }
+        static inline void setBit(uint32 * mask, std::size_t pos)       { mask[pos / 32] |= (1U << (pos % 32)); }
+        static inline void clearBit(uint32 * mask, std::size_t pos)     { mask[pos / 32] &= ~(1U << (pos % 32)); }
+
+        /** Update the monitored events for the socket at the given position */
+        bool update(std::size_t pos)
+        {
+            struct epoll_event ev = {};
+            ev.events = hasBit(writeMask, pos) ? EPOLLOUT : EPOLLIN;
+            ev.data.u32 = (uint32)pos;
+            return ::epoll_ctl(epollFD, EPOLL_CTL_MOD, sockets[pos]->socket, &ev) == 0;
+        }
+
+        /** Append a socket to the pool */
+        bool append(BaseSocket & socket) {
+            if (used == N || epollFD == -1) return false;
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.u32 = (uint32)used;
+            if (::epoll_ctl(epollFD, EPOLL_CTL_ADD, socket.socket, &ev) != 0) return false;
+            sockets[used++] = &socket;
+            return true;
+        }
+        /** Remove a socket from the pool */
+        bool remove(BaseSocket & socket) {
+            if (!used) return false;
+            // Find the socket to remove
+            for (std::size_t i = 0; i < used; i++)
+            {
+                if (sockets[i] == &socket) {
+                    // A closed socket is automatically removed from the epoll set by the kernel
+                    if (socket.socket != -1) ::epoll_ctl(epollFD, EPOLL_CTL_DEL, socket.socket, NULL);
+                    std::size_t u = used - 1;
+                    sockets[i] = sockets[u]; // Swap with last
+                    if (hasBit(writeMask, u)) setBit(writeMask, i); else clearBit(writeMask, i);
+                    clearBit(writeMask, u);
+                    sockets[u] = 0;
+                    --used;
+                    // The last socket moved, so update its position in the kernel's set
+                    if (i != u && sockets[i]->socket != -1) update(i);
+                    // And in the pending events too
+                    for (int e = 0; e < readyCount; e++)
+                    {
+                        if (events[e].data.u32 == i)      events[e].data.u32 = Consumed;
+                        else if (events[e].data.u32 == u) events[e].data.u32 = (uint32)i;
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+        /** Monitor the given socket for writing instead of reading (or revert to reading)
+            This is used when a socket's send buffer is full and the answer is sent asynchronously */
+        bool watchForWriting(BaseSocket & socket, bool writing)
+        {
+            for (std::size_t i = 0; i < used; i++)
+            {
+                if (sockets[i] == &socket) {
+                    if (writing) setBit(writeMask, i); else clearBit(writeMask, i);
+                    return update(i);
+                }
+            }
+            return false;
+        }
+        /** Select the sockets that are active for reading (or writing if watched for). Use this and getReadableSocket() to fetch the socket that's readable
+            @return positive value upon any socket readable in the pool, 0 for timeout, negative value upon error */
+        Error selectActive(const uint32 timeoutMillis = (uint32)-1)
+        {
+            readyCount = 0;
+            int ret = ::epoll_wait(epollFD, events, (int)N, timeoutMillis == (uint32)-1 ? -1 : (int)timeoutMillis);
+            if (ret == 0) return Timeout;
+            if (ret < 0) return Select;
+            readyCount = ret;
+            return Success;
+        }
+
+        /** Get the next readable socket. This doesn't work without having called selectActive() first (and it returned > 0)
+            @return 0 if no more readable socket is available or the socket's pointer else */
+        BaseSocket * getReadableSocket(std::size_t startPos = 0)
+        {
+            for (int e = 0; e < readyCount; e++) {
+                uint32 pos = events[e].data.u32;
+                if (pos != Consumed && pos >= startPos && pos < used) {
+                    events[e].data.u32 = Consumed;
+                    return sockets[pos];
+                }
+            }
+            return 0;
+        }
+        /** Check if a specific socket position is readable */
+        bool isReadable(std::size_t pos) const {
+            for (int e = 0; e < readyCount; e++)
+                if (events[e].data.u32 == pos) return true;
+            return false;
+        }
+
+        SocketPool() : used(0), epollFD(::epoll_create1(EPOLL_CLOEXEC)), readyCount(0) { Zero(sockets); Zero(writeMask); }
+        ~SocketPool() { if (epollFD != -1) ::close(epollFD); }
+        SocketPool(const SocketPool &) = delete;
+    };
+#else
     /** A socket pool used to select multiple socket at once.
         The order of the sockets in the pool isn't preserved upon removing sockets (removing is done with swapping with the last used element in the array).
         Appending sockets are always done to the end of the pool.  */
@@ -430,11 +818,23 @@ namespace Network {
     {
         BaseSocket *    sockets[N] = {};
         std::size_t     used = 0;
-        uint32          selectMask;
+        /** The readable status of each socket in the pool, one bit per socket position */
+        uint32          selectMask[(N + 31) / 32];
+        /** The sockets that are monitored for writing instead of reading, one bit per socket position */
+        uint32          writeMask[(N + 31) / 32];
+
+        /** Bit manipulation helpers for the masks above */
+        static inline bool hasBit(const uint32 * mask, std::size_t pos) { return mask[pos / 32] & (1U << (pos % 32)); }
+        static inline void setBit(uint32 * mask, std::size_t pos)       { mask[pos / 32] |= (1U << (pos % 32)); }
+        static inline void clearBit(uint32 * mask, std::size_t pos)     { mask[pos / 32] &= ~(1U << (pos % 32)); }
+        static inline void moveBit(uint32 * mask, std::size_t to, std::size_t from) { if (hasBit(mask, from)) setBit(mask, to); else clearBit(mask, to); clearBit(mask, from); }
 
         /** Append a socket to the pool */
         bool append(BaseSocket & socket) {
             if (used == N) return false;
+            // Select can't monitor descriptors above this limit
+            if (socket.socket >= FD_SETSIZE) return false;
+            clearBit(writeMask, used);
             sockets[used++] = &socket;
             return true;
         }
@@ -442,14 +842,14 @@ namespace Network {
         bool remove(BaseSocket & socket) {
             if (!used) return false;
             // Find the socket to remove
-            for (std::size_t i = 0; i < N; i++)
+            for (std::size_t i = 0; i < used; i++)
             {
                 if (sockets[i] == &socket) {
                     std::size_t u = used - 1;
                     sockets[i] = sockets[u]; // Swap with last
-                    if (selectMask & (1<<u))
-                        // Swap the select status too
-                        selectMask ^= (1<<u) | ((selectMask & (1<<i)) ? 0 : (1<<i));
+                    // Swap the select status too (the removed socket's status is lost)
+                    moveBit(selectMask, i, u);
+                    moveBit(writeMask, i, u);
                     sockets[u] = 0;
                     --used;
                     return true;
@@ -457,28 +857,42 @@ namespace Network {
             }
             return false;
         }
-        /** Select the sockets that are active for reading. Use this and getReadableSocket() to fetch the socket that's readable
+        /** Monitor the given socket for writing instead of reading (or revert to reading)
+            This is used when a socket's send buffer is full and the answer is sent asynchronously */
+        bool watchForWriting(BaseSocket & socket, bool writing)
+        {
+            for (std::size_t i = 0; i < used; i++)
+            {
+                if (sockets[i] == &socket) {
+                    if (writing) setBit(writeMask, i); else clearBit(writeMask, i);
+                    return true;
+                }
+            }
+            return false;
+        }
+        /** Select the sockets that are active for reading (or writing if watched for). Use this and getReadableSocket() to fetch the socket that's readable
             @return positive value upon any socket readable in the pool, 0 for timeout, negative value upon error */
         Error selectActive(const uint32 timeoutMillis = (uint32)-1)
         {
             // Linux modifies the timeout when calling select
             struct timeval v = timeoutFromMs(timeoutMillis);
-            selectMask = 0;
+            Zero(selectMask);
 
-            fd_set set;
+            fd_set readSet, writeSet;
             int max = 0;
-            FD_ZERO(&set);
+            FD_ZERO(&readSet);
+            FD_ZERO(&writeSet);
             for (std::size_t i = 0; i < used; i++) {
                 if (sockets[i] == 0) return -1; // Impossible case, should log it
-                FD_SET(sockets[i]->socket, &set);
+                FD_SET(sockets[i]->socket, hasBit(writeMask, i) ? &writeSet : &readSet);
                 max = max > sockets[i]->socket ? max : sockets[i]->socket;
             }
             // Then select
-            int ret = ::select(max + 1, &set, NULL, NULL, timeoutMillis == (uint32)-1 ? NULL : &v);
+            int ret = ::select(max + 1, &readSet, &writeSet, NULL, timeoutMillis == (uint32)-1 ? NULL : &v);
             if (ret == 0) return Timeout;
             if (ret < 0) return ret;
-            for (std::size_t i = 0; i < used; i++) {
-                if (FD_ISSET(sockets[i]->socket, &set)) selectMask |= (uint32)(1<<i);
+            for (std::size_t i = 0; i < used && ret; i++) {
+                if (FD_ISSET(sockets[i]->socket, &readSet) || FD_ISSET(sockets[i]->socket, &writeSet)) { setBit(selectMask, i); --ret; }
             }
             return Success;
         }
@@ -487,21 +901,24 @@ namespace Network {
             @return 0 if no more readable socket is available or the socket's pointer else */
         BaseSocket * getReadableSocket(std::size_t startPos = 0)
         {
-            if (!selectMask) return 0;
-            for (std::size_t i = startPos; i < used; i++) {
-                if ((selectMask & (1<<i))) {
-                    selectMask ^= (uint32)(1<<i);
-                    return sockets[i];
-                }
+            // Skip the empty words directly
+            for (std::size_t w = startPos / 32; w < ArrSz(selectMask) && w * 32 < used; w++) {
+                uint32 word = selectMask[w];
+                if (w == startPos / 32) word &= ~((1U << (startPos % 32)) - 1);
+                if (!word) continue;
+                std::size_t i = w * 32 + (std::size_t)__builtin_ctz(word);
+                if (i >= used) return 0;
+                clearBit(selectMask, i);
+                return sockets[i];
             }
-            // Should never happens
             return 0;
         }
         /** Check if a specific socket position is readable */
-        bool isReadable(std::size_t pos) const { return selectMask & (1<<pos); }
+        bool isReadable(std::size_t pos) const { return hasBit(selectMask, pos); }
 
-        SocketPool() : used(0), selectMask(0) { Zero(sockets); }
+        SocketPool() : used(0) { Zero(sockets); Zero(selectMask); Zero(writeMask); }
     };
+#endif
 
 
 }
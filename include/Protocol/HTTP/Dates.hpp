@@ -0,0 +1,86 @@
+#ifndef hpp_HTTP_Dates_hpp
+#define hpp_HTTP_Dates_hpp
+
+// We need a string-view like class for avoiding useless copy here
+#include "Strings/ROString.hpp"
+// We need time_t and gmtime_r
+#include <time.h>
+
+namespace Protocol::HTTP
+{
+    /** The length of a date in the HTTP format (IMF-fixdate, RFC9110 5.6.7), like "Sun, 06 Nov 1994 08:49:37 GMT" */
+    static constexpr std::size_t DateLength = sizeof("Sun, 06 Nov 1994 08:49:37 GMT") - 1;
+
+    namespace Private
+    {
+        static constexpr const char WeekDays[] = "SunMonTueWedThuFriSat";
+        static constexpr const char Months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+        /** Parse a fixed length number */
+        inline bool parseDigits(const char * p, const std::size_t length, int & value)
+        {
+            value = 0;
+            for (std::size_t i = 0; i < length; i++)
+            {
+                if (p[i] < '0' || p[i] > '9') return false;
+                value = value * 10 + (p[i] - '0');
+            }
+            return true;
+        }
+    }
+
+    /** Format the given time as an HTTP date.
+        This doesn't depend on the locale, unlike strftime
+        @param time     The time to format, in seconds since epoch
+        @param buffer   The output buffer, it must be at least DateLength + 1 bytes long, it's zero terminated
+        @return the formatted length */
+    inline std::size_t formatDate(const time_t time, char * buffer)
+    {
+        struct tm t;
+        if (!gmtime_r(&time, &t)) { buffer[0] = 0; return 0; }
+        auto two = [](char * p, const int v) { p[0] = (char)('0' + v / 10); p[1] = (char)('0' + v % 10); };
+        memcpy(buffer, &Private::WeekDays[t.tm_wday * 3], 3);
+        memcpy(buffer + 3, ", ", 2);
+        two(buffer + 5, t.tm_mday);
+        buffer[7] = ' ';
+        memcpy(buffer + 8, &Private::Months[t.tm_mon * 3], 3);
+        buffer[11] = ' ';
+        const int year = t.tm_year + 1900;
+        two(buffer + 12, year / 100);
+        two(buffer + 14, year % 100);
+        buffer[16] = ' ';
+        two(buffer + 17, t.tm_hour);
+        buffer[19] = ':';
+        two(buffer + 20, t.tm_min);
+        buffer[22] = ':';
+        two(buffer + 23, t.tm_sec);
+        memcpy(buffer + 25, " GMT", 5);
+        return DateLength;
+    }
+
+    /** Parse an HTTP date. Only the preferred format is supported, the obsolete ones (RFC850 and asctime) aren't used anymore
+        @param date     The date to parse, like "Sun, 06 Nov 1994 08:49:37 GMT"
+        @param time     On output, the parsed time in seconds since epoch
+        @return false if the date is invalid */
+    inline bool parseDate(const ROString & date, time_t & time)
+    {
+        const char * p = date.getData();
+        if ((std::size_t)date.getLength() < DateLength || p[3] != ',' || memcmp(p + 25, " GMT", 4)) return false;
+        int day, year, hour, minute, second, month = 0;
+        while (month < 12 && memcmp(p + 8, &Private::Months[month * 3], 3)) month++;
+        if (month == 12 || !Private::parseDigits(p + 5, 2, day) || !Private::parseDigits(p + 12, 4, year)
+            || !Private::parseDigits(p + 17, 2, hour) || !Private::parseDigits(p + 20, 2, minute) || !Private::parseDigits(p + 23, 2, second))
+            return false;
+        if (year < 1970 || !day || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+        // Count the days since epoch from the civil date, with years starting in March so the leap day is the last one
+        month++;
+        const int y = year - (month <= 2), era = y / 400, yoe = y - era * 400;
+        const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const long days = (long)era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+        time = (time_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+        return true;
+    }
+}
+
+#endif
@@ -200,19 +200,31 @@ namespace Protocol::HTTP
             }
         };
         /** Enum value with quality factor ";q=[.0-9]+,token="
-            The quality factor is ignored and so is any token */
+            The quality factor is stored in thousandths (so 1000 for q=1, the default), any other token is ignored */
         template <typename Enum> struct EnumValueToken : public ValueBase, public LowLevelAccess<EnumValueToken<Enum>>
         {
             typedef Enum ValueType;
             Enum value;
+            uint16 quality = 1000;
             virtual ParsingError parseFrom(ROString & val)
             {
                 ROString v, t;
                 ParsingError err = EnumValueWithToken::parseFrom(val, v, t);
                 if (err == InvalidRequest) return err;
                 value = Refl::fromString<Enum>(v).orElse(static_cast<Enum>(-1));
+                quality = parseQuality(t.fromFirst("q="));
                 return err;
             }
+            /** Parse a quality value like "0.8" or "1" (at most 3 decimals are allowed by RFC 7231) */
+            static uint16 parseQuality(const ROString & q)
+            {
+                std::size_t len = (std::size_t)q.getLength();
+                if (!len) return 1000;
+                uint16 r = q[0] == '1' ? 1000 : 0;
+                if (len < 2 || q[1] != '.') return r;
+                for (std::size_t i = 2, m = 100; i < 5 && i < len && q[i] >= '0' && q[i] <= '9'; i++, m /= 10) r += (uint16)((q[i] - '0') * m);
+                return r > 1000 ? 1000 : r;
+            }
 #if MinimizeStackSize == 1
             bool send(BaseSocket & socket) const
             {
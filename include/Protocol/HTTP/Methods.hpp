@@ -122,6 +122,7 @@ namespace Protocol::HTTP
         TransferEncoding,
         Upgrade,
         UserAgent,
+        Vary,
         IF(MaxSupport, Via, )
         WWWAuthenticate,
         IF(MaxSupport, XClientDate, )
@@ -204,6 +205,7 @@ namespace Protocol::HTTP
         IF(MaxSupport, Trailer = (int8)Headers::Trailer, )
         TransferEncoding = (int8)Headers::TransferEncoding,
         Upgrade = (int8)Headers::Upgrade,
+        Vary = (int8)Headers::Vary,
         WWWAuthenticate = (int8)Headers::WWWAuthenticate,
     };
 
@@ -7,6 +7,8 @@
 #include "HeaderMap.hpp"
 // We need concepts too
 #include "Concepts.hpp"
+// We need fast delimiter search
+#include "Scan.hpp"
 
 
 #if defined(MaxSupport)
@@ -126,12 +128,12 @@ namespace Protocol::HTTP
         /** Parse the given data stream */
         ParsingError parse(ROString & input)
         {
-            ROString m = input.splitUpTo(" ");
+            ROString m = Scan::splitUpTo<' '>(input);
             method = Refl::fromString<Method>(m).orElse(Protocol::HTTP::Method::Invalid);
             if (method == Method::Invalid) return InvalidRequest;
 
             input = input.trimLeft(' ');
-            URI = input.splitUpTo(" ");
+            URI = Scan::splitUpTo<' '>(input);
             if (!URI || !input) return InvalidRequest;
 
             input = input.trimLeft(' ');
@@ -154,14 +156,14 @@ namespace Protocol::HTTP
         {
             input = input.trimmedLeft();
             if (!input) return EndOfRequest; // End of headers here or error
-            header = input.splitUpTo(":").trimRight(' ');
+            header = Scan::splitUpTo<':'>(input).trimRight(' ');
             return MoreData;
         }
 
         /** Skip value for this header */
         static ParsingError skipValue(ROString & input)
         {
-            input.splitUpTo("\r\n");
+            (void)Scan::splitUpToLineEnd(input);
             return MoreData;
         }
 
@@ -170,7 +172,7 @@ namespace Protocol::HTTP
         {
             input = input.trimLeft(' ');
             if (!input) return InvalidRequest;
-            value = input.splitUpTo("\r\n").trimRight(' ');
+            value = Scan::splitUpToLineEnd(input).trimRight(' ');
             return MoreData;
         }
     };
@@ -239,7 +241,7 @@ namespace Protocol::HTTP
         bool acceptHeader(ROString & hdr) const { return hdr == Refl::toString(h); }
         /** Accept the value for this header */
         virtual ParsingError acceptValue(ROString & input, ROString & val) {
-            val = input.splitUpTo("\r\n");
+            val = Scan::splitUpToLineEnd(input);
             ROString tmp = val;
             val = val.trimRight(' ');
             return parsed.parseFrom(tmp);
@@ -0,0 +1,104 @@
+#ifndef hpp_HTTP_Scan_hpp
+#define hpp_HTTP_Scan_hpp
+
+// We need a string-view like class for avoiding useless copy here
+#include "Strings/ROString.hpp"
+// We need memcpy
+#include <string.h>
+#if defined(__SSE2__)
+  // We need the SSE2 intrinsics on x86 hosts
+  #include <emmintrin.h>
+#endif
+
+/** Fast searching of the delimiters in a request (like CR, LF, ':' or ' ').
+    On ESP32, the bytes are compared a machine word at a time (SWAR), with aligned loads only since Xtensa can't load unaligned words.
+    On x86 hosts, SSE2 is used to compare 16 bytes at a time */
+namespace Protocol::HTTP::Scan
+{
+    namespace Private
+    {
+        /** The scanning word, 32 bits on ESP32 and 64 bits on most hosts */
+        typedef std::size_t Word;
+        static constexpr Word Ones = ~(Word)0 / 0xFF;
+        static constexpr Word Lows = Ones * 0x7F;
+
+        /** Get a word where the high bit of each byte equal to the pattern's byte is set.
+            Unlike the usual "has zero byte" trick, there's no false positive since the carries can't cross the bytes */
+        inline Word match(const Word w, const Word pattern)
+        {
+            const Word x = w ^ pattern;
+            return ~(((x & Lows) + Lows) | x | Lows);
+        }
+        /** Get the index of the first matching byte in the result of match */
+        inline std::size_t firstMatch(const Word m)
+        {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            if constexpr (sizeof(Word) == sizeof(unsigned long long)) return (std::size_t)__builtin_clzll(m) / 8;
+            else return (std::size_t)__builtin_clz(m) / 8;
+#else
+            if constexpr (sizeof(Word) == sizeof(unsigned long long)) return (std::size_t)__builtin_ctzll(m) / 8;
+            else return (std::size_t)__builtin_ctz(m) / 8;
+#endif
+        }
+    }
+
+    /** Find the first occurrence of any of the given bytes
+        @return The position of the first byte found, or size if none is found */
+    template <char ... bytes>
+    inline std::size_t find(const char * data, const std::size_t size)
+    {
+        std::size_t i = 0;
+#if defined(__SSE2__)
+        for (; i + 16 <= size; i += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i r = _mm_setzero_si128();
+            ((r = _mm_or_si128(r, _mm_cmpeq_epi8(v, _mm_set1_epi8(bytes)))), ...);
+            if (const int m = _mm_movemask_epi8(r)) return i + (std::size_t)__builtin_ctz((unsigned)m);
+        }
+#else
+        // Compare the bytes until the first aligned word
+        for (; i < size && (std::uintptr_t)(data + i) % sizeof(Private::Word); i++)
+            if (((data[i] == bytes) || ...)) return i;
+        for (; i + sizeof(Private::Word) <= size; i += sizeof(Private::Word))
+        {
+            Private::Word w;
+            memcpy(&w, __builtin_assume_aligned(data + i, sizeof(w)), sizeof(w));
+            if (const Private::Word m = (Private::match(w, Private::Ones * (uint8)bytes) | ...)) return i + Private::firstMatch(m);
+        }
+#endif
+        for (; i < size; i++)
+            if (((data[i] == bytes) || ...)) return i;
+        return size;
+    }
+
+    /** Find the first line ending (CRLF)
+        @return The position of the line ending, or size if none is found */
+    inline std::size_t findLineEnd(const char * data, const std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; i++)
+        {
+            i += find<'\r'>(data + i, size - i);
+            if (i + 1 < size && data[i + 1] == '\n') return i;
+        }
+        return size;
+    }
+
+    /** Split the input at the given position, skipping the delimiter (if found), like ROString::splitUpTo */
+    inline ROString splitAt(ROString & input, const std::size_t pos, const std::size_t delimiterLength)
+    {
+        const bool found = pos < (std::size_t)input.getLength();
+        ROString ret = input.splitAt((int)pos);
+        if (found) (void)input.splitAt((int)delimiterLength);
+        return ret;
+    }
+
+    /** Split the input up to the first given byte, this is equivalent to ROString::splitUpTo with a single byte delimiter */
+    template <char c>
+    inline ROString splitUpTo(ROString & input) { return splitAt(input, find<c>(input.getData(), (std::size_t)input.getLength()), 1); }
+
+    /** Split the input up to the first line ending, this is equivalent to ROString::splitUpTo("\r\n") */
+    inline ROString splitUpToLineEnd(ROString & input) { return splitAt(input, findLineEnd(input.getData(), (std::size_t)input.getLength()), 2); }
+}
+
+#endif
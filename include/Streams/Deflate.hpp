@@ -0,0 +1,275 @@
+#ifndef hpp_Deflate_hpp
+#define hpp_Deflate_hpp
+
+// We need the streams interface
+#include "Streams.hpp"
+
+namespace Streams
+{
+    namespace Private
+    {
+        /** The CRC32 table used by the gzip format, computed at compile time */
+        struct CRC32Table
+        {
+            uint32 value[256];
+            constexpr CRC32Table() : value()
+            {
+                for (uint32 i = 0; i < 256; i++)
+                {
+                    uint32 c = i;
+                    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+                    value[i] = c;
+                }
+            }
+        };
+        inline constexpr CRC32Table crc32Table;
+
+        /** The fixed Huffman codes for the literals and lengths (RFC1951 3.2.6), already bit reversed since they are written LSB first */
+        struct FixedHuffman
+        {
+            uint16 code[288];
+            uint8  length[288];
+            constexpr FixedHuffman() : code(), length()
+            {
+                for (uint32 i = 0; i < 288; i++)
+                {
+                    uint32 c = i < 144 ? 0x30 + i : i < 256 ? 0x190 + i - 144 : i < 280 ? i - 256 : 0xC0 + i - 280;
+                    uint32 l = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8, r = 0;
+                    for (uint32 b = 0; b < l; b++) r |= ((c >> b) & 1) << (l - 1 - b);
+                    code[i] = (uint16)r;
+                    length[i] = (uint8)l;
+                }
+            }
+        };
+        inline constexpr FixedHuffman fixedHuffman;
+    }
+
+    /** The state of a deflate compressor. It's too large for the stack, so it's allocated once (statically) by the application and reused for
+        each compressed answer. It must not be used by 2 streams at the same time (use one state per shard with a ShardedServer).
+        The memory used is 2^(WindowBits+1) + 2^(HashBits+1) + OutputSize bytes.
+        @param WindowBits   The log2 of the window size (the maximum distance for a match), from 9 to 14
+        @param HashBits     The log2 of the hash table's size (the larger, the better the compression)
+        @param OutputSize   The size of the compressed output buffer, that's the size of each chunk sent to the socket */
+    template <std::size_t WindowBits = 11, std::size_t HashBits = 10, std::size_t OutputSize = 512>
+    struct DeflateState
+    {
+        static_assert(WindowBits >= 9 && WindowBits <= 14, "The window must be larger than the maximum match length and positions must fit 16 bits");
+        static constexpr std::size_t WindowSize = 1 << WindowBits;
+        static constexpr std::size_t WindowLog = WindowBits;
+        static constexpr std::size_t HashSize = 1 << HashBits;
+        static constexpr std::size_t HashLog = HashBits;
+        static constexpr std::size_t BufferSize = OutputSize;
+
+        /** The last WindowSize bytes that were compressed, followed by the bytes to compress */
+        uint8   window[2 * WindowSize];
+        /** The last position (plus one, 0 meaning none) in the window of each 3 bytes sequence's hash */
+        uint16  head[HashSize];
+        /** The compressed data, waiting to be written */
+        uint8   output[OutputSize];
+    };
+
+    /** A compressing output stream, writing the deflated data (RFC1951) to the given output stream, in raw, zlib (RFC1950) or gzip (RFC1952) format.
+        This is made for dynamic content that's produced on the fly, so it's fast and small instead of compressing the most: matches are searched
+        with a single hash lookup (no chain) and coded with the fixed Huffman codes. This is enough for redundant content like JSON or HTML.
+        No memory is allocated, the window and buffers are in the given state.
+        Call finish() once all data was written, to flush the compressed data and write the format's trailer.
+        @param Out      The output stream to write the compressed data to, typically a BufferedChunkedOutput
+        @param State    The compressor's state, see DeflateState */
+    template <typename Out, typename State>
+    struct DeflateOutput final : public Output<DeflateOutput<Out, State>>, public Private::NonSeekable, public Private::NonMappeable, public Private::WithContent
+    {
+        /** The format of the compressed stream */
+        enum Format
+        {
+            Raw,
+            Zlib,
+            Gzip,
+        };
+
+        std::size_t getSize() const { return 0; }
+        std::size_t write(const void * buf, const std::size_t size)
+        {
+            const uint8 * in = (const uint8*)buf;
+            updateChecksum(in, size);
+            std::size_t left = size;
+            while (left)
+            {
+                if (end == sizeof(state.window)) slide();
+                std::size_t n = min(left, sizeof(state.window) - end);
+                memcpy(&state.window[end], in, n);
+                end += n; in += n; left -= n;
+                if (!compress(false)) return 0;
+            }
+            total += (uint32)size;
+            return size;
+        }
+
+        /** Compress the remaining data and write the format's trailer
+            @return false upon error */
+        bool finish()
+        {
+            if (!compress(true) || !flush()) return false;
+            // End the current block and add an empty final block, since we couldn't know the previous block was the last one
+            putCode(256);
+            putBits(1, 1); putBits(1, 2); putCode(256);
+            if (bitCount) putBits(0, 8 - bitCount);
+            if (format == Zlib)
+            {
+                uint32 adler = (adlerB << 16) | adlerA;
+                for (int i = 24; i >= 0; i -= 8) putByte((uint8)(adler >> i));
+            }
+            else if (format == Gzip)
+            {
+                for (int i = 0; i < 32; i += 8) putByte((uint8)(~crc >> i));
+                for (int i = 0; i < 32; i += 8) putByte((uint8)(total >> i));
+            }
+            return flush();
+        }
+
+        /** Build a compressing stream
+            @param out      The output stream to write the compressed data to
+            @param state    The compressor's state (its content doesn't need to be initialized) */
+        DeflateOutput(Out & out, State & state, const Format format = Gzip)
+            : out(out), state(state), format(format), pos(0), end(0), used(0), bitBuffer(0), bitCount(0), crc(0xFFFFFFFFU), adlerA(1), adlerB(0), total(0)
+        {
+            memset(state.head, 0, sizeof(state.head));
+            if (format == Zlib)
+            {   // CMF with the window size, and FLG making the header a multiple of 31
+                uint8 cmf = (uint8)(0x08 | ((State::WindowLog - 8) << 4));
+                putByte(cmf);
+                putByte((uint8)(31 - (cmf * 256) % 31));
+            }
+            else if (format == Gzip)
+            {   // No name, no time, unknown OS
+                static constexpr uint8 header[] = { 0x1f, 0x8b, 0x08, 0, 0, 0, 0, 0, 0, 0xff };
+                for (uint8 c : header) putByte(c);
+            }
+            // Start a fixed Huffman block
+            putBits(0, 1); putBits(1, 2);
+        }
+
+    private:
+        static constexpr std::size_t WindowSize = State::WindowSize;
+        static constexpr std::size_t MinMatch = 3;
+        static constexpr std::size_t MaxMatch = 258;
+
+        Out &           out;
+        State &         state;
+        Format          format;
+        /** The position of the next byte to compress and the end of the data in the window */
+        std::size_t     pos, end;
+        /** The used size in the output buffer */
+        std::size_t     used;
+        uint32          bitBuffer, bitCount;
+        uint32          crc, adlerA, adlerB, total;
+
+        static uint32 hash(const uint8 * p) { return (((uint32)p[0] << 16 | (uint32)p[1] << 8 | p[2]) * 2654435761U) >> (32 - State::HashLog); }
+
+        /** Update the format's checksum with the given data */
+        void updateChecksum(const uint8 * in, std::size_t size)
+        {
+            if (format == Gzip)
+            {
+                for (std::size_t i = 0; i < size; i++) crc = Private::crc32Table.value[(crc ^ in[i]) & 0xFF] ^ (crc >> 8);
+            }
+            else if (format == Zlib)
+            {
+                while (size)
+                {   // 5552 is the largest count of bytes that can't overflow the sums before the modulo
+                    std::size_t n = min(size, 5552);
+                    for (std::size_t i = 0; i < n; i++) { adlerA += in[i]; adlerB += adlerA; }
+                    adlerA %= 65521; adlerB %= 65521;
+                    in += n; size -= n;
+                }
+            }
+        }
+
+        /** Drop the oldest half of the window, it's out of reach of any match now */
+        void slide()
+        {
+            memmove(state.window, &state.window[WindowSize], WindowSize);
+            end -= WindowSize;
+            pos -= WindowSize;
+            for (uint16 & h : state.head) h = h > WindowSize ? (uint16)(h - WindowSize) : 0;
+        }
+
+        /** Compress the data in the window
+            @param all  If false, keep at least a maximum match length of data for the next call, so matches aren't cut */
+        bool compress(const bool all)
+        {
+            while (pos < end && (all || end - pos >= MaxMatch))
+            {
+                const std::size_t avail = end - pos;
+                std::size_t length = 0, distance = 0;
+                if (avail >= MinMatch)
+                {
+                    uint16 & head = state.head[hash(&state.window[pos])];
+                    if (head && pos - (head - 1) <= WindowSize)
+                    {
+                        const uint8 * a = &state.window[pos], * b = &state.window[head - 1];
+                        const std::size_t limit = min(avail, MaxMatch);
+                        while (length < limit && a[length] == b[length]) length++;
+                        if (length >= MinMatch) distance = pos - (head - 1);
+                        else length = 0;
+                    }
+                    head = (uint16)(pos + 1);
+                }
+                if (length)
+                {
+                    putMatch(length, distance);
+                    // Index the matched sequence too, for the next matches
+                    for (std::size_t i = 1; i < length && pos + i + MinMatch <= end; i++)
+                        state.head[hash(&state.window[pos + i])] = (uint16)(pos + i + 1);
+                    pos += length;
+                }
+                else putCode(state.window[pos++]);
+                if (used > State::BufferSize - 8 && !flush()) return false;
+            }
+            return true;
+        }
+
+        void putByte(const uint8 c) { state.output[used++] = c; }
+        void putBits(const uint32 value, const uint32 count)
+        {
+            bitBuffer |= value << bitCount;
+            bitCount += count;
+            while (bitCount >= 8) { putByte((uint8)bitBuffer); bitBuffer >>= 8; bitCount -= 8; }
+        }
+        void putCode(const uint32 symbol) { putBits(Private::fixedHuffman.code[symbol], Private::fixedHuffman.length[symbol]); }
+        void putMatch(const std::size_t length, const std::size_t distance)
+        {
+            // Length code (RFC1951 3.2.5), 258 has its own code
+            uint32 n = (uint32)length - 3;
+            if (length == MaxMatch) putCode(285);
+            else if (n < 8) putCode(257 + n);
+            else
+            {
+                uint32 b = 31 - (uint32)__builtin_clz(n);
+                putCode(257 + 4 * (b - 1) + ((n >> (b - 2)) & 3));
+                putBits(n & ((1U << (b - 2)) - 1), b - 2);
+            }
+            // Distance code, the fixed codes are 5 bits long
+            n = (uint32)distance - 1;
+            uint32 code = n, b = 0;
+            if (n >= 4)
+            {
+                b = 31 - (uint32)__builtin_clz(n);
+                code = 2 * b + ((n >> (b - 1)) & 1);
+            }
+            uint32 r = 0;
+            for (uint32 i = 0; i < 5; i++) r |= ((code >> i) & 1) << (4 - i);
+            putBits(r, 5);
+            if (b) putBits(n & ((1U << (b - 1)) - 1), b - 1);
+        }
+        /** Write the compressed data to the output stream */
+        bool flush()
+        {
+            if (!used) return true;
+            bool ok = out.write(state.output, used) == used;
+            used = 0;
+            return ok;
+        }
+    };
+}
+
+#endif
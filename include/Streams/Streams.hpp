@@ -13,6 +13,14 @@
 // We need socket code too
 #include "Network/Socket.hpp"
 
+#if LinuxHost == 1
+  // We need mmap and madvise for mapped files
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
 /** This is where streams are declared */
 namespace Streams
 {
@@ -119,6 +127,8 @@ namespace Streams
             bool hasContent() const                 { return f ? true : false; }
             std::size_t getPos() const              { return f ? (std::size_t)ftello(f) : 0; }
             bool setPos(const std::size_t pos)      { return f ? fseeko(f, pos, SEEK_SET) == 0 : false; }
+            /** Get the underlying file descriptor (to use with system calls like sendfile) */
+            int getFileDescriptor() const           { return f ? fileno(f) : -1; }
 
         public:
             FileBase(const char * path, bool write) : f(fopen(path, write ? "wb" : "rb")), size(0){ computeSize(); }
@@ -136,6 +146,9 @@ namespace Streams
                 }
             }
             void close(bool close = true) { if (close && f) fclose(f); f = nullptr; size = 0; }
+            /** Take over the given file (the other file is left empty) */
+            void moveFrom(FileBase & other) { close(); f = other.f; size = other.size; other.close(false); }
+            FileBase() : f(nullptr), size(0) {}
             // Prevent instantiating this class directly, except for derived class
             ~FileBase() {}
             FILE * f;
@@ -217,6 +230,8 @@ namespace Streams
     struct FileInput final : public Input<FileInput>, public Private::FileBase
     {
         using Private::FileBase::getSize;
+        using Private::FileBase::getPos;
+        using Private::FileBase::setPos;
         std::size_t read(void * buf, const std::size_t size) { return f ? fread(buf, 1, size, f) : 0; }
         FileInput(const char * path) : FileBase(path, false) {}
         FileInput(const int fileDescriptor) : FileBase(fileDescriptor, false) {}
@@ -226,6 +241,147 @@ namespace Streams
         FileInput(FileInput && input) : FileBase(std::move(input)) {}
     };
 
+#if LinuxHost == 1
+    struct ParkedInput;
+    /** A memory mapped file input stream.
+        The whole file is mapped (read only) upon first use, so its content can be sent directly from the mapping without copying it to an
+        intermediate buffer first (a file whose content isn't sent, like for a HEAD request, isn't mapped). The kernel is told the mapping is
+        read sequentially, so it reads ahead aggressively.
+        This is best used for read only files that are served often, since their pages stay in the page cache */
+    struct MappedFileInput final : public Input<MappedFileInput>
+    {
+        std::size_t getSize() const             { return size; }
+        bool hasContent() const                 { return found; }
+        std::size_t getPos() const              { return pos; }
+        bool setPos(const std::size_t pos)      { return pos <= size ? this->pos = pos, true : false; }
+
+        void * map(const std::size_t size = 0)  { return size <= this->size && mapFile() ? (void*)data : nullptr; }
+        void unmap(void *)                      { }
+        std::size_t read(void * buf, const std::size_t size)
+        {
+            if (!mapFile()) return 0;
+            std::size_t q = min((this->size - pos), size);
+            if (q) memcpy(buf, data + pos, q);
+            pos += q;
+            return q;
+        }
+
+    public:
+        MappedFileInput(const char * path) : data(nullptr), size(0), pos(0), fd(-1), found(false)
+        {
+            fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return;
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+            {
+                found = true;
+                size = (std::size_t)st.st_size;
+            }
+            else { ::close(fd); fd = -1; }
+        }
+        ~MappedFileInput() { if (data) ::munmap((void*)data, size); if (fd >= 0) ::close(fd); }
+
+        MappedFileInput(const MappedFileInput &) = delete;
+        MappedFileInput(MappedFileInput && input) : data(input.data), size(input.size), pos(input.pos), fd(input.fd), found(input.found)
+        {
+            input.data = nullptr; input.size = 0; input.fd = -1; input.found = false;
+        }
+
+    private:
+        /** Map the file if it's not done yet
+            @return true if the file is mapped (an empty file is never mapped) */
+        bool mapFile()
+        {
+            if (data || fd < 0 || !size) return data != nullptr;
+            void * m = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            // The mapping stays valid once the descriptor is closed
+            ::close(fd);
+            fd = -1;
+            if (m == MAP_FAILED) return false;
+            data = (const uint8*)m;
+            // The advices are values, not flags, so they can't be combined
+            ::madvise(m, size, MADV_SEQUENTIAL);
+            ::madvise(m, size, MADV_WILLNEED);
+            return true;
+        }
+
+        const uint8 * data;
+        std::size_t size;
+        std::size_t pos;
+        int fd;
+        bool found;
+        friend struct ParkedInput;
+    };
+#endif
+
+    /** A file based input stream that was taken from another stream, or a content in memory.
+        This is used to continue reading the stream later on, when the initial stream's owner is gone (like when sending an answer asynchronously) */
+    struct ParkedInput final : public Input<ParkedInput>, public Private::FileBase
+    {
+        using Private::FileBase::getSize;
+        using Private::FileBase::getPos;
+        std::size_t read(void * buf, const std::size_t size)
+        {
+            std::size_t pos = getPos();
+            return f && pos < end ? fread(buf, 1, min(size, end - pos), f) : 0;
+        }
+        /** Take over the given input stream, it's left empty
+            @param offset   If positive, the content is sent from the file descriptor (with sendfile) starting from this offset
+            @param end      If not 0, the position to stop sending at (for a range of the stream), else the stream is sent up to its end */
+        void take(FileInput & input, const off_t offset = -1, const std::size_t end = 0) { release(); moveFrom(input); this->offset = offset; this->end = end ? end : size; }
+        /** Take the given content in memory, it must stay valid until this stream is released
+            @param data     The content
+            @param offset   The position of the next byte to send
+            @param end      The position to stop sending at
+            @param pin      If not null, it's incremented until this stream is released, so the content's owner knows it can't modify it */
+        void take(const uint8 * data, const off_t offset, const std::size_t end, uint16 * pin = nullptr)
+        {
+            release();
+            memory = data; this->offset = offset; this->end = end; this->pin = pin;
+            if (pin) ++*pin;
+        }
+#if LinuxHost == 1
+        /** Take over the given mapped input stream's mapping, it's left empty
+            @param offset   The position of the next byte to send from the mapping
+            @param end      If not 0, the position to stop sending at (for a range of the stream), else the stream is sent up to its end */
+        void take(MappedFileInput & input, const off_t offset, const std::size_t end = 0)
+        {
+            release();
+            memory = input.data; size = input.size; mapped = memory != nullptr; this->offset = offset; this->end = end ? end : size;
+            input.data = nullptr; input.size = 0; input.found = false;
+        }
+        /** Close the parked stream, if any */
+        void release()
+        {
+            if (mapped) ::munmap((void*)memory, size);
+            mapped = false;
+            if (pin) --*pin;
+            memory = nullptr; pin = nullptr; close(); offset = -1;
+        }
+        /** Whether the memory content is a mapping taken from a mapped input stream */
+        bool mapped = false;
+#else
+        /** Close the parked stream, if any */
+        void release()
+        {
+            if (pin) --*pin;
+            memory = nullptr; pin = nullptr; close(); offset = -1;
+        }
+#endif
+        /** The content to send from memory, if any */
+        const uint8 * memory = nullptr;
+        /** The content owner's counter of parked streams, if any */
+        uint16 * pin = nullptr;
+        /** The offset of the next byte to send when sending directly from the file descriptor or the memory, or -1 if the file is read instead */
+        off_t offset = -1;
+        /** The position to stop sending at */
+        std::size_t end = 0;
+        ParkedInput() {}
+        ~ParkedInput() { release(); }
+
+        ParkedInput(const ParkedInput &) = delete;
+    };
+
     /** A file based output stream */
     struct FileOutput final : public Output<FileOutput>, public Private::FileBase
     {
@@ -292,6 +448,100 @@ namespace Streams
         Socket socketStream;
     };
 
+    /** A chunk based output stream that's coalescing the written data in the given buffer, so many small writes are sent as a single chunk
+        with a single system call (instead of a chunk and 3 system calls per write with ChunkedOutput).
+        A chunk is sent when the buffered data reaches the flush size. Writes larger than this are sent as their own chunk, directly from the
+        caller's memory (along with the buffered data).
+        Call flush() to send the buffered data now, and finish() once all data was written to send the last chunk */
+    struct BufferedChunkedOutput final : public Output<BufferedChunkedOutput>, public Private::NonSeekable, public Private::NonMappeable, public Private::WithContent
+    {
+        std::size_t getSize() const { return 0; }
+        std::size_t write(const void * buf, const std::size_t size)
+        {
+            if (!size) return 0;
+            if (size >= flushSize) return send(buf, size, false) ? size : 0;
+            const uint8 * in = (const uint8*)buf;
+            std::size_t left = size;
+            while (left)
+            {
+                std::size_t n = min(left, capacity - used);
+                memcpy(&buffer[used], in, n);
+                used += n; in += n; left -= n;
+                if (used - HeaderRoom >= flushSize && !flush()) return 0;
+            }
+            return size;
+        }
+
+        /** Get the free space in the buffer, to write data in place instead of copying it (then call commit) */
+        uint8 * getTail() { return &buffer[used]; }
+        std::size_t freeSize() const { return capacity - used; }
+        /** Get the maximum size of the data that can be buffered */
+        std::size_t getCapacity() const { return capacity - HeaderRoom; }
+        /** Commit the data written in place (see getTail), it's sent like written data
+            @return false upon error */
+        bool commit(const std::size_t size)
+        {
+            used += min(size, freeSize());
+            return used - HeaderRoom < flushSize || flush();
+        }
+
+        /** Send the buffered data as a chunk now */
+        bool flush() { return send(nullptr, 0, false); }
+        /** Send the buffered data and the last chunk, ending the content */
+        bool finish() { return send(nullptr, 0, true); }
+
+        /** Build a buffered chunked stream
+            @param socket       The socket to send the chunks to
+            @param buffer       The buffer to coalesce the written data into, it's used while the stream exists
+            @param size         The buffer's size
+            @param flushSize    The size of the buffered data that triggers sending a chunk, 0 meaning when the buffer is full.
+                                Use 1 to send each write as soon as it's done (like for an event stream) */
+        BufferedChunkedOutput(Network::BaseSocket & socket, uint8 * buffer, const std::size_t size, const std::size_t flushSize = 0)
+            : socket(socket), buffer(buffer), capacity(size > HeaderRoom + TrailerRoom ? size - TrailerRoom : HeaderRoom), used(HeaderRoom),
+              flushSize(flushSize && flushSize < capacity - HeaderRoom ? flushSize : capacity - HeaderRoom) {}
+
+    private:
+        /** The room kept before the buffered data for the chunk's size line, and after it for the chunk's end */
+        static constexpr std::size_t HeaderRoom = sizeof("FFFFFFFF\r\n") - 1;
+        static constexpr std::size_t TrailerRoom = 2;
+
+        Network::BaseSocket &   socket;
+        uint8 *                 buffer;
+        /** The end of the usable area in the buffer and the end of the buffered data */
+        std::size_t             capacity, used;
+        std::size_t             flushSize;
+
+        /** Send the buffered data as a chunk, followed by the given data as another chunk and the last chunk if asked, in a single system call */
+        bool send(const void * data, const std::size_t size, const bool last)
+        {
+            static constexpr const char LastChunk[] = "0\r\n\r\n";
+            struct iovec vec[5];
+            int count = 0;
+            char header[HeaderRoom + 1] = {};
+            if (used > HeaderRoom)
+            {   // The size line is written just before the data, so the chunk is contiguous
+                intToStr((int)(used - HeaderRoom), header, 16);
+                std::size_t l = strlen(header), start = HeaderRoom - l - 2;
+                memcpy(&buffer[start], header, l);
+                memcpy(&buffer[start + l], "\r\n", 2);
+                memcpy(&buffer[used], "\r\n", 2);
+                vec[count++] = { &buffer[start], used + 2 - start };
+            }
+            if (size)
+            {
+                intToStr((int)size, header, 16);
+                std::size_t l = strlen(header);
+                memcpy(&header[l], "\r\n", 2);
+                vec[count++] = { header, l + 2 };
+                vec[count++] = { (void*)data, size };
+                vec[count++] = { (void*)(LastChunk + 3), 2 };
+            }
+            if (last) vec[count++] = { (void*)LastChunk, sizeof(LastChunk) - 1 };
+            used = HeaderRoom;
+            return !count || !socket.sendv(vec, count).isError();
+        }
+    };
+
 
     /** A chunk based input stream, following HTTP/1.1 RFC standard */
     struct ChunkedInput final : public Input<ChunkedInput>, public Private::NonSeekable, public Private::NonMappeable, public Private::WithContent
@@ -368,6 +618,17 @@ namespace Streams
     std::size_t copy(In & in, Out & out, uint8 * buffer, std::size_t bufSize, const std::size_t size = (std::size_t)-1)
     {
         std::size_t total = 0, step = 0;
+        // Mapped streams are written directly from their mapping, without any intermediate copy
+        if constexpr (requires { (const uint8 *)in.map(); })
+        {
+            if (const uint8 * data = (const uint8 *)in.map())
+            {
+                std::size_t pos = in.getPos();
+                total = out.write(data + pos, min(in.getSize() - pos, size));
+                in.setPos(pos + total);
+                return total;
+            }
+        }
         while (true)
         {
             step = in.read(buffer,  min(size - total, bufSize));
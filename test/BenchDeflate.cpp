@@ -0,0 +1,103 @@
+// Benchmark of the on the fly deflate compressor (Streams/Deflate.hpp): CPU cost against bytes saved, for a few state sizes, compared
+// with zlib. Each compressed output is checked by decompressing it with zlib.
+// Build on a Linux host with: g++ -std=c++20 -O2 -I../include -I<esp-eCommon>/include BenchDeflate.cpp -lz -o BenchDeflate
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 1024
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Streams/Deflate.hpp"
+
+#include <zlib.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    typedef std::vector<uint8> Data;
+
+    /** A stream collecting the compressed data */
+    struct Sink
+    {
+        Data data;
+        std::size_t write(const void * buffer, const std::size_t size) { data.insert(data.end(), (const uint8*)buffer, (const uint8*)buffer + size); return size; }
+    };
+
+    /** Decompress with zlib and compare with the input */
+    template <typename Format>
+    bool check(const Data & input, const Data & compressed, const Format format)
+    {
+        Data output(input.size() + 1);
+        z_stream z = {};
+        inflateInit2(&z, format == Format::Gzip ? 31 : format == Format::Zlib ? 15 : -15);
+        z.next_in = (Bytef*)compressed.data(); z.avail_in = (uInt)compressed.size();
+        z.next_out = output.data(); z.avail_out = (uInt)output.size();
+        const bool ended = inflate(&z, Z_FINISH) == Z_STREAM_END;
+        const std::size_t length = z.total_out;
+        inflateEnd(&z);
+        return ended && length == input.size() && std::equal(input.begin(), input.end(), output.begin());
+    }
+
+    /** Compress the input, written in random sized pieces like a capturing callback would, and print the ratio and speed */
+    template <std::size_t WindowBits, std::size_t HashBits>
+    bool bench(const char * name, const Data & input)
+    {
+        typedef Streams::DeflateState<WindowBits, HashBits> State;
+        typedef Streams::DeflateOutput<Sink, State> Deflate;
+        static State state;
+        constexpr int Loops = 20;
+        Sink sink;
+        const auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < Loops; k++)
+        {
+            sink.data.clear();
+            Deflate deflate(sink, state, Deflate::Gzip);
+            std::mt19937 rng(k);
+            for (std::size_t pos = 0, length; pos < input.size(); pos += length)
+            {
+                length = std::min<std::size_t>(input.size() - pos, 1 + rng() % 3000);
+                deflate.write(&input[pos], length);
+            }
+            deflate.finish();
+        }
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Loops;
+        const bool ok = check(input, sink.data, Deflate::Gzip);
+        printf("%-8s DeflateState<%2zu, %2zu> (%5zu bytes): %7zu -> %7zu bytes (%5.1f%%) %7.1f MB/s %s\n", name, WindowBits, HashBits, sizeof(State),
+               input.size(), sink.data.size(), 100.0 * (double)sink.data.size() / (double)input.size(), (double)input.size() / us, ok ? "" : "FAILED");
+        return ok;
+    }
+
+    void benchZlib(const char * name, const Data & input, const int level)
+    {
+        constexpr int Loops = 20;
+        Data output(compressBound((uLong)input.size()));
+        uLongf length = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < Loops; k++) { length = (uLongf)output.size(); compress2(output.data(), &length, input.data(), (uLong)input.size(), level); }
+        const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Loops;
+        printf("%-8s zlib level %d                       : %7zu -> %7zu bytes (%5.1f%%) %7.1f MB/s\n", name, level,
+               input.size(), (std::size_t)length, 100.0 * (double)length / (double)input.size(), (double)input.size() / us);
+    }
+}
+
+int main()
+{
+    // A JSON telemetry dump
+    Data json;
+    char line[128];
+    for (int i = 0; json.size() < 100000; i++)
+    {
+        const int length = snprintf(line, sizeof(line), "{\"id\":%d,\"temp\":%d.%d,\"name\":\"sensor%d\",\"ok\":true},\n", i, 20 + i % 7, i % 10, i % 13);
+        json.insert(json.end(), line, line + length);
+    }
+    // Incompressible data, the worst case
+    Data random(50000);
+    std::mt19937 rng(1);
+    for (uint8 & c : random) c = (uint8)rng();
+
+    bool ok = bench<9, 8>("json", json) & bench<11, 10>("json", json) & bench<14, 14>("json", json);
+    benchZlib("json", json, 1);
+    benchZlib("json", json, 6);
+    ok &= bench<11, 10>("random", random);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Benchmark of the delimiters' search (Protocol/HTTP/Scan.hpp) against ROString's byte by byte search, on realistic browser header blocks.
+// The search results are checked against ROString's ones on random data first.
+// Build on a Linux host with: g++ -std=c++20 -O2 -I../include -I<esp-eCommon>/include BenchScan.cpp -o BenchScan
+// Add -DNoSIMD to benchmark the portable SWAR version (used on ESP32) instead of SSE2.
+#ifdef NoSIMD
+  #undef __SSE2__
+#endif
+#include "Types.hpp"
+#include "Protocol/HTTP/Scan.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace Protocol::HTTP;
+
+namespace
+{
+    // A request from a desktop browser (about 600 bytes)
+    constexpr const char browserRequest[] = "GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.9,fr;q=0.8\r\nAccept-Encoding: gzip, deflate, br\r\nConnection: keep-alive\r\n"
+        "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; _ga=GA1.2.1234567890.1234567890\r\n"
+        "Upgrade-Insecure-Requests: 1\r\nSec-Fetch-Dest: document\r\nSec-Fetch-Mode: navigate\r\nSec-Fetch-Site: none\r\nSec-Fetch-User: ?1\r\n"
+        "Cache-Control: max-age=0\r\n\r\n";
+    // An API request with the client hints and a larger cookie (about 1000 bytes)
+    constexpr const char largeRequest[] = "GET /api/v1/devices?page=2 HTTP/1.1\r\nHost: www.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36 Edg/120.0.0.0\r\n"
+        "Accept: application/json, text/plain, */*\r\nAccept-Language: en-US,en;q=0.9,fr;q=0.8,de;q=0.7\r\nAccept-Encoding: gzip, deflate, br, zstd\r\n"
+        "Referer: https://www.example.com/dashboard/devices/overview?filter=active&sort=name\r\nOrigin: https://www.example.com\r\n"
+        "Sec-Ch-Ua: \"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\", \"Microsoft Edge\";v=\"120\"\r\nSec-Ch-Ua-Mobile: ?0\r\nSec-Ch-Ua-Platform: \"Windows\"\r\n"
+        "Cookie: session=0123456789abcdef0123456789abcdef0123456789abcdef; theme=dark; lang=en; _ga=GA1.2.1234567890.1234567890; "
+        "_gid=GA1.2.0987654321.0987654321; consent=analytics%3Dtrue%26marketing%3Dfalse%26functional%3Dtrue\r\n"
+        "Sec-Fetch-Dest: empty\r\nSec-Fetch-Mode: cors\r\nSec-Fetch-Site: same-origin\r\nConnection: keep-alive\r\n"
+        "If-None-Match: \"5f3e2a1b-4c2\"\r\nCache-Control: no-cache\r\nPragma: no-cache\r\n\r\n";
+
+    /** Check the search results against ROString's on random data, with random alignments */
+    bool check()
+    {
+        std::mt19937 rng(1);
+        char buffer[300];
+        for (int t = 0; t < 200000; t++)
+        {
+            const int n = (int)(rng() % 200), offset = (int)(rng() % 16);
+            for (int i = 0; i < n + 2; i++) { const int r = (int)(rng() % 40); buffer[offset + i] = r == 0 ? '\r' : r == 1 ? '\n' : r == 2 ? ':' : (char)(0x80 + r); }
+            const char * data = buffer + offset;
+            std::size_t expected = (std::size_t)n;
+            for (int i = 0; i < n; i++) if (data[i] == ':' || data[i] == '\n') { expected = (std::size_t)i; break; }
+            if (Scan::find<':', '\n'>(data, (std::size_t)n) != expected) return false;
+
+            ROString input(data, n), reference(data, n);
+            ROString a = Scan::splitUpToLineEnd(input), b = reference.splitUpTo("\r\n");
+            if (a.getData() != b.getData() || a.getLength() != b.getLength() || input.getData() != reference.getData() || input.getLength() != reference.getLength())
+                return false;
+        }
+        return true;
+    }
+
+    /** Split the header block in lines and the lines in name and value, like the header parser does */
+    template <bool useScan>
+    void bench(const char * name, const char * block, const std::size_t length)
+    {
+        constexpr int Loops = 200000;
+        std::size_t total = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < Loops; k++)
+        {
+            ROString input(block, (int)length);
+            asm volatile("" : : "r"(&input) : "memory");
+            while (input.getLength())
+            {
+                ROString header = useScan ? Scan::splitUpTo<':'>(input) : input.splitUpTo(":");
+                ROString value = useScan ? Scan::splitUpToLineEnd(input) : input.splitUpTo("\r\n");
+                total += (std::size_t)(header.getLength() + value.getLength());
+            }
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / Loops;
+        printf("%-9s %4zu bytes: %7.1f ns/block, %5.2f GB/s (%zu)\n", name, length, ns, (double)length / ns, total);
+    }
+}
+
+int main()
+{
+    if (!check()) { printf("FAILED: the search results differ from ROString's\n"); return 1; }
+#ifdef __SSE2__
+    printf("Scan uses SSE2\n");
+#else
+    printf("Scan uses SWAR on %zu bits words\n", sizeof(std::size_t) * 8);
+#endif
+    bench<false>("ROString", browserRequest, sizeof(browserRequest) - 1);
+    bench<true>("Scan", browserRequest, sizeof(browserRequest) - 1);
+    bench<false>("ROString", largeRequest, sizeof(largeRequest) - 1);
+    bench<true>("Scan", largeRequest, sizeof(largeRequest) - 1);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Benchmark of the incremental request scanner: requests are fed to a client one byte at a time (like a request trickling in many TCP
+// segments) and the time to find the end of the headers is compared with a rescan from the buffer's start on each byte (the previous way).
+// Build on a Linux host with: g++ -std=c++20 -O2 -I../include -I<esp-eCommon>/include BenchScanner.cpp ../src/Normalization.cpp -o BenchScanner
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 2048
+#define CONFIG_ESP_EHTTPD_TLS_SERVER 0
+#define CONFIG_ESP_EHTTPD_TLS_CLIENT 0
+#define CONFIG_ESP_EHTTPD_CLIENT_ENABLED 0
+#define CONFIG_ESP_EHTTPD_MINIMIZE_STACK_SIZE 1
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Network/InternalErrors.hpp"
+// Silence the server's logs
+template <typename ... Args> void testLog(Network::Level, const char *, Args && ...) {}
+#define SLog testLog
+#include "Network/Servers/HTTP.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+using namespace Network::Servers::HTTP;
+
+namespace
+{
+    /** Build a request with headers up to about the given size */
+    std::string makeRequest(const std::size_t size)
+    {
+        std::string request = "GET /index.html HTTP/1.1\r\nHost: www.example.com\r\n";
+        for (int i = 0; request.size() + 40 < size; i++) request += "X-Header-" + std::to_string(i) + ": some value for the header\r\n";
+        return request + "\r\n";
+    }
+
+    /** Feed the request byte by byte to the client, until the headers are received
+        @return false if the client didn't find the end of the headers */
+    bool feed(Client & client, const std::string & request)
+    {
+        client.closed();
+        client.accepted();
+        for (char c : request)
+        {
+            *client.recvBuffer.getTail() = (uint8)c;
+            client.recvBuffer.stored(1);
+            if (!client.parse()) return false;
+            if (client.parsingStatus == Client::HeadersDone) return true;
+        }
+        return false;
+    }
+
+    /** The previous way: search the request line's and the headers' ending from the buffer's start on each received byte */
+    bool feedAndRescan(Client & client, const std::string & request)
+    {
+        client.closed();
+        bool requestLine = false;
+        for (char c : request)
+        {
+            *client.recvBuffer.getTail() = (uint8)c;
+            client.recvBuffer.stored(1);
+            ROString buffer = client.recvBuffer.getView<ROString>();
+            asm volatile("" : : "r"(&buffer) : "memory");
+            if (!requestLine) { requestLine = buffer.Find("\r\n") != buffer.getLength(); continue; }
+            if (buffer.Find(EOM) != buffer.getLength()) return true;
+        }
+        return false;
+    }
+
+    template <typename Feed>
+    double bench(Client & client, const std::string & request, Feed feed)
+    {
+        constexpr int Loops = 5000;
+        const auto start = std::chrono::steady_clock::now();
+        for (int k = 0; k < Loops; k++) if (!feed(client, request)) return -1;
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / Loops;
+    }
+
+    Client client;
+}
+
+int main()
+{
+    printf("Request size    Incremental (us)    Rescan (us)\n");
+    for (std::size_t size : { 150, 300, 600, 1200, 1900 })
+    {
+        const std::string request = makeRequest(size);
+        const double incremental = bench(client, request, feed), rescan = bench(client, request, feedAndRescan);
+        if (incremental < 0 || rescan < 0) { printf("FAILED: the end of the headers wasn't found for %zu bytes\n", request.size()); return 1; }
+        printf("%12zu %20.2f %14.2f\n", request.size(), incremental, rescan);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Loopback benchmark of the sharded server: the same load (keep-alive clients making requests back to back) is run against 1, 2, 4 and 8
+// shards, and the requests per second are printed for each. The clients run in the same process, so use a machine with more cores than
+// the largest shard count plus the client threads to see the scaling.
+// Build on a Linux host with: g++ -std=c++20 -O2 -pthread -I../include -I<esp-eCommon>/include BenchShards.cpp ../src/Normalization.cpp -o BenchShards
+#define CONFIG_ESP_EHTTPD_KEEPALIVE_TIMEOUT_MS 5000
+#define CONFIG_ESP_EHTTPD_HEADER_TIMEOUT_MS 5000
+#define CONFIG_ESP_EHTTPD_BATCH_ACCEPT 1
+#define CONFIG_ESP_EHTTPD_USE_EPOLL 1
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 1024
+#define CONFIG_ESP_EHTTPD_TLS_SERVER 0
+#define CONFIG_ESP_EHTTPD_TLS_CLIENT 0
+#define CONFIG_ESP_EHTTPD_CLIENT_ENABLED 0
+#define CONFIG_ESP_EHTTPD_MINIMIZE_STACK_SIZE 1
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Network/InternalErrors.hpp"
+// Silence the server's logs
+template <typename ... Args> void testLog(Network::Level, const char *, Args && ...) {}
+#define SLog testLog
+#include "Network/Servers/Shards.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+
+using namespace Network::Servers::HTTP;
+
+namespace
+{
+    constexpr std::size_t ClientCount = 32;
+    constexpr int DurationMs = 2000;
+    constexpr auto hello = [](Client & c, const auto &) { return c.reply(Code::Ok, "Hello world"); };
+    constexpr Router<Route<hello, MethodsMask{Method::GET}, "/hello", Headers::Host>{}> router;
+
+    int connectTo(const uint16 port)
+    {
+        int s = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0) { ::close(s); return -1; }
+        return s;
+    }
+
+    /** Make requests on a kept alive connection until the deadline
+        @return The number of answered requests */
+    std::size_t client(const uint16 port, const std::chrono::steady_clock::time_point deadline)
+    {
+        static constexpr const char request[] = "GET /hello HTTP/1.1\r\nHost: bench\r\nConnection: keep-alive\r\n\r\n";
+        const int s = connectTo(port);
+        if (s == -1) return 0;
+        std::size_t count = 0;
+        char buffer[512];
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            if (::send(s, request, sizeof(request) - 1, MSG_NOSIGNAL) != (ssize_t)sizeof(request) - 1) break;
+            // The answer ends with its content
+            std::size_t used = 0;
+            while (used < 11 || memcmp(buffer + used - 11, "Hello world", 11))
+            {
+                ssize_t r = ::recv(s, buffer + used, sizeof(buffer) - used, 0);
+                if (r <= 0) { ::close(s); return count; }
+                used += (std::size_t)r;
+            }
+            count++;
+        }
+        ::close(s);
+        return count;
+    }
+
+    template <std::size_t ShardCount>
+    void bench(const uint16 port)
+    {
+        // Large object, so not on the stack
+        static ShardedServer<router, ClientCount, ShardCount> server;
+        if (server.create(port).isError()) { printf("FAILED: can't listen on port %u\n", port); return; }
+        server.start();
+
+        std::atomic<std::size_t> total = 0;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(DurationMs);
+        std::thread clients[ClientCount];
+        for (std::thread & t : clients) t = std::thread([&] { total += client(port, deadline); });
+        for (std::thread & t : clients) t.join();
+        server.stop();
+        printf("%zu shards: %10.0f requests/s\n", ShardCount, (double)total * 1000 / DurationMs);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const uint16 port = (uint16)(argc > 1 ? atoi(argv[1]) : 18090);
+    signal(SIGPIPE, SIG_IGN);
+    printf("%zu keep-alive clients on %u cores\n", ClientCount, std::thread::hardware_concurrency());
+    // Each shard count listens on its own port, since the previous shards' sockets are still open
+    bench<1>(port);
+    bench<2>((uint16)(port + 1));
+    bench<4>((uint16)(port + 2));
+    bench<8>((uint16)(port + 3));
+    return 0;
+}
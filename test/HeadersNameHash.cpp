@@ -0,0 +1,71 @@
+// Static test of the header names' perfect hash: it must build (and be correct) for any header count a route can list.
+// Build on a Linux host with: g++ -std=c++20 -I../include -I<esp-eCommon>/include HeadersNameHash.cpp -o HeadersNameHash
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 1024
+#define CONFIG_ESP_EHTTPD_TLS_SERVER 0
+#define CONFIG_ESP_EHTTPD_TLS_CLIENT 0
+#define CONFIG_ESP_EHTTPD_CLIENT_ENABLED 0
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Network/Common/HeadersArray.hpp"
+
+using namespace Network::Common::HTTP;
+
+namespace
+{
+    /** Build the hashes of Count synthetic header names, like "X-Header-042" */
+    template <std::size_t Count>
+    constexpr std::array<uint32, Count> syntheticHashes()
+    {
+        std::array<uint32, Count> hashes = {};
+        for (std::size_t i = 0; i < Count; i++)
+        {
+            char name[] = "X-Header-000";
+            name[9] = (char)('0' + i / 100); name[10] = (char)('0' + i / 10 % 10); name[11] = (char)('0' + i % 10);
+            hashes[i] = Details::headerNameHash(name, sizeof(name) - 1);
+        }
+        return hashes;
+    }
+
+    /** Check that each hash is found at its own position */
+    template <std::size_t Count>
+    constexpr bool check(const std::array<uint32, Count> & hashes)
+    {
+        const Details::PerfectHash<Count> table(hashes);
+        if (!table.built) return false;
+        for (std::size_t i = 0; i < Count; i++) if (table.find(hashes[i]) != i) return false;
+        return true;
+    }
+
+    static_assert(check(syntheticHashes<1>()));
+    static_assert(check(syntheticHashes<24>()));
+    static_assert(check(syntheticHashes<32>()));
+    static_assert(check(syntheticHashes<48>()));
+    static_assert(check(syntheticHashes<56>()));
+    static_assert(check(syntheticHashes<61>()));
+    static_assert(check(syntheticHashes<64>()));
+    static_assert(check(syntheticHashes<128>()));
+    static_assert(check(syntheticHashes<254>()));
+
+    // All the headers in a single route, that's 61 names with MaxSupport
+    template <std::size_t ... i>
+    constexpr auto allHeaders(std::index_sequence<i...>) { return std::array<Headers, sizeof...(i)>{ (Headers)i... }; }
+    constexpr auto headers = allHeaders(std::make_index_sequence<(std::size_t)Headers::XForwardedFor + 1>{});
+    typedef Details::HeadersNameHash<headers> AllHeaders;
+}
+
+int main()
+{
+    // Each name must be found case insensitively, and a prefix or an unknown name must not be found
+    int errors = 0;
+    for (std::size_t i = 0; i < headers.size(); i++)
+    {
+        char name[64] = {};
+        const char * expected = Refl::toString(headers[i]);
+        const std::size_t length = strlen(expected);
+        for (std::size_t j = 0; j < length; j++) name[j] = expected[j] >= 'a' && expected[j] <= 'z' ? (char)(expected[j] - 0x20) : expected[j];
+        if (AllHeaders::find(ROString(name, (int)length)) != i) errors++;
+        if (length > 1 && AllHeaders::find(ROString(name, (int)length - 1)) == i) errors++;
+    }
+    if (AllHeaders::find(ROString("X-Unknown-Header")) != headers.size()) errors++;
+    printf("%s: %d errors\n", errors ? "FAILED" : "OK", errors);
+    return errors ? 1 : 0;
+}
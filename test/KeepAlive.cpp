@@ -0,0 +1,110 @@
+// Test the clients' timeouts with short delays: a busy kept alive connection must stay open past the keep-alive timeout, an idle one must
+// be closed after it, and a request trickled byte by byte must not extend its header timeout.
+// Build on a Linux host with: g++ -std=c++20 -pthread -I../include -I<esp-eCommon>/include KeepAlive.cpp ../src/Normalization.cpp -o KeepAlive
+#define CONFIG_ESP_EHTTPD_KEEPALIVE_TIMEOUT_MS 300
+#define CONFIG_ESP_EHTTPD_HEADER_TIMEOUT_MS 300
+#define CONFIG_ESP_EHTTPD_BATCH_ACCEPT 1
+#define CONFIG_ESP_EHTTPD_USE_EPOLL 0
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 1024
+#define CONFIG_ESP_EHTTPD_TLS_SERVER 0
+#define CONFIG_ESP_EHTTPD_TLS_CLIENT 0
+#define CONFIG_ESP_EHTTPD_CLIENT_ENABLED 0
+#define CONFIG_ESP_EHTTPD_MINIMIZE_STACK_SIZE 1
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Network/InternalErrors.hpp"
+// Silence the server's logs
+template <typename ... Args> void testLog(Network::Level, const char *, Args && ...) {}
+#define SLog testLog
+#include "Network/Servers/Route.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <csignal>
+
+using namespace Network::Servers::HTTP;
+
+namespace
+{
+    constexpr auto hello = [](Client & c, const auto &) { return c.reply(Code::Ok, "Hello world"); };
+    constexpr Router<Route<hello, MethodsMask{Method::GET}, "/hello", Headers::Host>{}> router;
+    Server<router, 4> server;
+    constexpr const char request[] = "GET /hello HTTP/1.1\r\nHost: test\r\nConnection: keep-alive\r\n\r\n";
+
+    int connectTo(const uint16 port)
+    {
+        int s = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct timeval tv = { 2, 0 };
+        ::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (::connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0) { ::close(s); return -1; }
+        return s;
+    }
+
+    /** Receive until the answer's content is found
+        @return false if the connection was closed before */
+    bool receiveAnswer(const int s)
+    {
+        char buffer[512];
+        std::size_t used = 0;
+        while (used < sizeof(buffer) - 1)
+        {
+            ssize_t r = ::recv(s, buffer + used, sizeof(buffer) - 1 - used, 0);
+            if (r <= 0) return false;
+            used += (std::size_t)r;
+            buffer[used] = 0;
+            if (strstr(buffer, "Hello world")) return true;
+        }
+        return false;
+    }
+
+    /** Check if the server closed the connection (within the receive timeout) */
+    bool isClosed(const int s)
+    {
+        char c;
+        return ::recv(s, &c, 1, 0) == 0;
+    }
+
+    void sleepMs(const int ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+}
+
+int main(int argc, char ** argv)
+{
+    const uint16 port = (uint16)(argc > 1 ? atoi(argv[1]) : 18091);
+    signal(SIGPIPE, SIG_IGN);
+    if (server.create(port).isError()) { printf("FAILED: can't listen on port %u\n", port); return 1; }
+    std::atomic<bool> stop = false;
+    std::thread loop([&] { while (!stop) server.loop(10); });
+    int errors = 0;
+
+    // A request every 100ms for 1.5s, that's 5 times the keep-alive timeout
+    int s = connectTo(port);
+    for (int i = 0; i < 15 && s != -1; i++)
+    {
+        if (::send(s, request, sizeof(request) - 1, MSG_NOSIGNAL) != (ssize_t)sizeof(request) - 1 || !receiveAnswer(s)) { errors++; break; }
+        sleepMs(100);
+    }
+    printf("Busy kept alive connection: %s\n", errors ? "closed" : "kept open");
+    // Then idle, so it must be closed
+    if (s == -1 || !isClosed(s)) { errors++; printf("Idle connection: not closed\n"); }
+    if (s != -1) ::close(s);
+
+    // A request trickled a byte every 100ms must be closed by the header timeout, before it's complete
+    s = connectTo(port);
+    bool closed = false;
+    for (std::size_t i = 0; i < sizeof(request) - 1 && s != -1 && !closed; i++)
+    {
+        closed = ::send(s, &request[i], 1, MSG_NOSIGNAL) != 1;
+        sleepMs(100);
+    }
+    if (!closed && (s == -1 || !isClosed(s))) { errors++; printf("Trickled request: not closed by the header timeout\n"); }
+    if (s != -1) ::close(s);
+
+    stop = true;
+    loop.join();
+    printf("%s\n", errors ? "FAILED" : "OK");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+// Test the select based pool with more than 32 concurrent clients: each loopback client keeps its connection open and makes 2 requests.
+// Then check that a client whose descriptor is above select's limit is rejected without leaking its slot, and that a client that can't be
+// accepted because the process is out of descriptors waits in the backlog without failing the server's loop.
+// Build on a Linux host with: g++ -std=c++20 -pthread -I../include -I<esp-eCommon>/include ManyClients.cpp ../src/Normalization.cpp -o ManyClients
+#define CONFIG_ESP_EHTTPD_KEEPALIVE_TIMEOUT_MS 5000
+#define CONFIG_ESP_EHTTPD_HEADER_TIMEOUT_MS 5000
+#define CONFIG_ESP_EHTTPD_BATCH_ACCEPT 1
+#define CONFIG_ESP_EHTTPD_USE_EPOLL 0
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 1024
+#define CONFIG_ESP_EHTTPD_TLS_SERVER 0
+#define CONFIG_ESP_EHTTPD_TLS_CLIENT 0
+#define CONFIG_ESP_EHTTPD_CLIENT_ENABLED 0
+#define CONFIG_ESP_EHTTPD_MINIMIZE_STACK_SIZE 1
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Network/InternalErrors.hpp"
+// Silence the server's logs
+template <typename ... Args> void testLog(Network::Level, const char *, Args && ...) {}
+#define SLog testLog
+#include "Network/Servers/Route.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <sys/resource.h>
+
+using namespace Network::Servers::HTTP;
+
+namespace
+{
+    constexpr std::size_t ClientCount = 100;
+    constexpr auto hello = [](Client & c, const auto &) { return c.reply(Code::Ok, "Hello world"); };
+    constexpr Router<Route<hello, MethodsMask{Method::GET}, "/hello", Headers::Host>{}> router;
+    // One more slot than the clients, so a leaked slot would make the last check fail
+    Server<router, ClientCount + 1> server;
+
+    /** Connect to the server, with the given socket if any */
+    int connectTo(const uint16 port, int s = -1)
+    {
+        if (s == -1) s = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct timeval tv = { 3, 0 };
+        ::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (::connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0) { ::close(s); return -1; }
+        return s;
+    }
+
+    bool sendRequest(const int s)
+    {
+        static constexpr const char request[] = "GET /hello HTTP/1.1\r\nHost: test\r\nConnection: keep-alive\r\n\r\n";
+        return ::send(s, request, sizeof(request) - 1, MSG_NOSIGNAL) == (ssize_t)sizeof(request) - 1;
+    }
+
+    /** Receive until the expected text is found (or the connection is closed) */
+    bool receive(const int s, const char * expected)
+    {
+        char buffer[512];
+        std::size_t used = 0;
+        while (used < sizeof(buffer) - 1)
+        {
+            ssize_t r = ::recv(s, buffer + used, sizeof(buffer) - 1 - used, 0);
+            if (r <= 0) break;
+            used += (std::size_t)r;
+            buffer[used] = 0;
+            if (strstr(buffer, expected)) return true;
+        }
+        return false;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const uint16 port = (uint16)(argc > 1 ? atoi(argv[1]) : 18089);
+    // The rejected client may be closed before its answer is sent
+    signal(SIGPIPE, SIG_IGN);
+    if (server.create(port).isError()) { printf("FAILED: can't listen on port %u\n", port); return 1; }
+    std::atomic<bool> stop = false;
+    std::atomic<int> loopErrors = 0;
+    std::thread loop([&] { while (!stop) if (server.loop(10).isError()) loopErrors++; });
+
+    int errors = 0, sockets[ClientCount];
+    for (std::size_t i = 0; i < ClientCount; i++)
+        if ((sockets[i] = connectTo(port)) == -1) errors++;
+    // All the connections are open at the same time, and kept alive for the second round
+    for (int round = 0; round < 2 && !errors; round++)
+    {
+        for (int s : sockets) if (!sendRequest(s)) errors++;
+        for (int s : sockets) if (!receive(s, "Hello world")) errors++;
+    }
+    printf("%zu concurrent clients: %d errors\n", ClientCount, errors);
+
+    // Fill the descriptors up to select's limit (if the process is allowed to go above it), so the next accepted socket can't be monitored
+    struct rlimit limit;
+    if (!errors && ::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_max > FD_SETSIZE + 8)
+    {
+        limit.rlim_cur = FD_SETSIZE + 8;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        int fillers[FD_SETSIZE] = {}, fillerCount = 0, fd;
+        while ((fd = ::dup(0)) != -1 && fd < FD_SETSIZE - 1) fillers[fillerCount++] = fd;
+        if (fd != -1) fillers[fillerCount++] = fd;
+
+        // The client's descriptor is FD_SETSIZE and the server's one is above
+        int s = connectTo(port);
+        if (s == -1 || !sendRequest(s) || !receive(s, " 503 ")) errors++;
+        if (s != -1) ::close(s);
+        while (fillerCount) ::close(fillers[--fillerCount]);
+
+        // The rejected client's slot must be available again
+        s = connectTo(port);
+        if (s == -1 || !sendRequest(s) || !receive(s, "Hello world")) errors++;
+        if (s != -1) ::close(s);
+        printf("Client above select's limit: %d errors\n", errors);
+
+        // Use all the descriptors (the client's socket is created before), so the server can't accept the client until one is released
+        s = ::socket(AF_INET, SOCK_STREAM, 0);
+        while ((fd = ::dup(0)) != -1) fillers[fillerCount++] = fd;
+        if (connectTo(port, s) == -1 || !sendRequest(s)) errors++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Release the lowest descriptor, so the accepted client is below select's limit
+        ::close(fillers[0]);
+        if (!receive(s, "Hello world")) errors++;
+        ::close(s);
+        for (int i = 1; i < fillerCount; i++) ::close(fillers[i]);
+        printf("Client accepted once a descriptor is released: %d errors, %d loop errors\n", errors, (int)loopErrors);
+        if (loopErrors) errors++;
+    }
+    else printf("Client above select's limit: skipped (descriptor limit too low)\n");
+
+    for (int s : sockets) if (s != -1) ::close(s);
+    stop = true;
+    loop.join();
+    printf("%s\n", errors ? "FAILED" : "OK");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+// Test that a client that doesn't read its answer doesn't block the server: a large cached file is parked while the client is stalled,
+// the other clients are answered meanwhile, and the stalled client receives the whole file once it reads again.
+// Build on a Linux host with: g++ -std=c++20 -pthread -I../include -I<esp-eCommon>/include SlowClient.cpp ../src/Normalization.cpp -o SlowClient
+#define CONFIG_ESP_EHTTPD_KEEPALIVE_TIMEOUT_MS 5000
+#define CONFIG_ESP_EHTTPD_HEADER_TIMEOUT_MS 5000
+#define CONFIG_ESP_EHTTPD_BATCH_ACCEPT 1
+#define CONFIG_ESP_EHTTPD_USE_EPOLL 0
+#define CONFIG_ESP_EHTTPD_CLIENT_BUFFER_SIZE 1024
+#define CONFIG_ESP_EHTTPD_TLS_SERVER 0
+#define CONFIG_ESP_EHTTPD_TLS_CLIENT 0
+#define CONFIG_ESP_EHTTPD_CLIENT_ENABLED 0
+#define CONFIG_ESP_EHTTPD_MINIMIZE_STACK_SIZE 1
+#define CONFIG_ESP_EHTTPD_MAX_SUPPORT 1
+#include "Network/InternalErrors.hpp"
+// Silence the server's logs
+template <typename ... Args> void testLog(Network::Level, const char *, Args && ...) {}
+#define SLog testLog
+#include "Network/Servers/Route.hpp"
+#include "Network/Servers/AssetCache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <csignal>
+
+using namespace Network::Servers::HTTP;
+
+namespace
+{
+    constexpr const char path[] = "/tmp/eHTTPd_SlowClient.bin";
+    // Much larger than the sockets' buffers
+    constexpr std::size_t FileSize = 8 * 1024 * 1024;
+    AssetCache<2, 5 * FileSize> cache;
+    constexpr auto cached = [](Client & c, const auto &) { return cache.serve(c, path); };
+    constexpr auto hello = [](Client & c, const auto &) { return c.reply(Code::Ok, "Hello world"); };
+    constexpr Router<Route<cached, MethodsMask{Method::GET}, "/cached", Headers::Host>{}, Route<hello, MethodsMask{Method::GET}, "/hello", Headers::Host>{}> router;
+    Server<router, 4> server;
+
+    int connectTo(const uint16 port, const int receiveBuffer = 0)
+    {
+        int s = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct timeval tv = { 2, 0 };
+        ::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (receiveBuffer) ::setsockopt(s, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+        if (::connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0) { ::close(s); return -1; }
+        return s;
+    }
+
+    bool sendRequest(const int s, const char * what)
+    {
+        char request[128];
+        int length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: test\r\nConnection: keep-alive\r\n\r\n", what);
+        return ::send(s, request, length, MSG_NOSIGNAL) == length;
+    }
+
+    /** Receive a whole answer and check its content
+        @param content  If not null, the expected content, else the content is the file's one */
+    bool receiveAnswer(const int s, const char * content)
+    {
+        char buffer[4096];
+        std::size_t used = 0, headers = 0;
+        // Receive the headers first
+        while (!headers)
+        {
+            ssize_t r = ::recv(s, buffer + used, sizeof(buffer) - 1 - used, 0);
+            if (r <= 0) return false;
+            used += (std::size_t)r;
+            buffer[used] = 0;
+            if (const char * end = strstr(buffer, "\r\n\r\n")) headers = (std::size_t)(end + 4 - buffer);
+            else if (used == sizeof(buffer) - 1) return false;
+        }
+        const char * length = strstr(buffer, "Content-Length:");
+        if (!length || strncmp(buffer, "HTTP/1.1 200", 12)) return false;
+        const std::size_t expected = (std::size_t)atol(length + 15);
+        if (content) return expected == strlen(content) && used - headers == expected && !memcmp(buffer + headers, content, expected);
+        if (expected != FileSize) return false;
+        // Then check the file's content
+        std::size_t pos = 0;
+        for (std::size_t i = headers; i < used; i++, pos++) if ((uint8)buffer[i] != (uint8)(pos * 7)) return false;
+        while (pos < FileSize)
+        {
+            ssize_t r = ::recv(s, buffer, min(sizeof(buffer), FileSize - pos), 0);
+            if (r <= 0) return false;
+            for (ssize_t i = 0; i < r; i++, pos++) if ((uint8)buffer[i] != (uint8)(pos * 7)) return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const uint16 port = (uint16)(argc > 1 ? atoi(argv[1]) : 18092);
+    signal(SIGPIPE, SIG_IGN);
+    FILE * f = fopen(path, "wb");
+    if (!f) { printf("FAILED: can't create %s\n", path); return 1; }
+    for (std::size_t i = 0; i < FileSize; i++) fputc((uint8)(i * 7), f);
+    fclose(f);
+
+    if (server.create(port).isError()) { printf("FAILED: can't listen on port %u\n", port); return 1; }
+    std::atomic<bool> stop = false;
+    std::thread loop([&] { while (!stop) server.loop(10); });
+    int errors = 0;
+
+    // Load the file in the cache
+    int s = connectTo(port);
+    if (s == -1 || !sendRequest(s, "/cached") || !receiveAnswer(s, nullptr)) errors++;
+    if (s != -1) ::close(s);
+    printf("Cached file: %s\n", errors ? "failed" : "received");
+
+    // A client that doesn't read its answer, with a small receive buffer
+    int stalled = connectTo(port, 4096);
+    if (stalled == -1 || !sendRequest(stalled, "/cached")) errors++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // The other clients must be answered meanwhile, even with the cached file
+    const auto start = std::chrono::steady_clock::now();
+    s = connectTo(port);
+    bool answered = s != -1 && sendRequest(s, "/hello") && receiveAnswer(s, "Hello world");
+    if (s != -1) ::close(s);
+    const long ms = (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    printf("Other client while a client is stalled: %s in %ld ms\n", answered ? "answered" : "not answered", ms);
+    if (!answered || ms > 1000) errors++;
+
+    // The stalled client now reads the whole file
+    if (stalled == -1 || !receiveAnswer(stalled, nullptr)) { errors++; printf("Stalled client: incomplete answer\n"); }
+    // And its connection is still usable
+    if (stalled == -1 || !sendRequest(stalled, "/hello") || !receiveAnswer(stalled, "Hello world")) { errors++; printf("Stalled client: not kept alive\n"); }
+    if (stalled != -1) ::close(stalled);
+
+    stop = true;
+    loop.join();
+    ::unlink(path);
+    printf("%s\n", errors ? "FAILED" : "OK");
+    return errors ? 1 : 0;
+}
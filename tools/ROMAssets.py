@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Generate a C++ header embedding a directory of assets (like a web UI) in the binary.
+
+Each asset is stored as a constexpr byte array containing the status line, the headers (Content-Type, Content-Length, ETag,
+Cache-Control and Vary/Content-Encoding for compressed variants) and the content, so the server sends it as is.
+A gzip variant is stored too if the file compresses well (or if a precompressed file.gz sibling exists).
+The assets are indexed with a minimal perfect hash, see ROMBundle in include/Network/Servers/ROMAssets.hpp.
+
+Usage: python3 tools/ROMAssets.py <assets directory> <output header> [namespace] [--max-age seconds] [--no-gzip]
+Then add ROMAssetsRoute<namespace::Bundle>{} as the last route of your router.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+# Keep this in sync with getMIMEFromExtension
+MIMETypes = {
+    "html": "text/html", "htm": "text/html", "css": "text/css", "js": "application/javascript",
+    "png": "image/png", "jpg": "image/jpeg", "jpeg": "image/jpeg", "gif": "image/gif", "svg": "image/svg+xml",
+    "webp": "image/webp", "xml": "application/xml", "txt": "text/plain",
+}
+StatusLine = b"HTTP/1.1 200 Ok\r\n"
+# Don't store a compressed variant if it doesn't save at least 10%
+MinGain = 0.9
+
+
+def assetHash(data, seed):
+    """Must match assetHash in ROMAssets.hpp (FNV-1a with a seed and a final mix, since FNV's low bits are weak)"""
+    h = 2166136261 ^ seed
+    for c in data:
+        h ^= c
+        h = (h * 16777619) & 0xFFFFFFFF
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    return h ^ (h >> 16)
+
+
+def perfectHash(keys):
+    """Build a minimal perfect hash with the hash and displace algorithm.
+    Returns the seeds for each bucket and the index of each key"""
+    count = len(keys)
+    bucketCount = max(1, count // 2)
+    buckets = [[] for _ in range(bucketCount)]
+    for i, k in enumerate(keys):
+        buckets[assetHash(k, 0) % bucketCount].append(i)
+
+    seeds = [0] * bucketCount
+    slots = [None] * count
+    # Place the largest buckets first, they are the hardest to place
+    for b in sorted(range(bucketCount), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+        seed = 1
+        while True:
+            pos = [assetHash(keys[i], seed) % count for i in buckets[b]]
+            if len(set(pos)) == len(pos) and all(slots[p] is None for p in pos):
+                break
+            seed += 1
+            if seed > 1 << 24:
+                sys.exit("Can't build a perfect hash for these assets")
+        seeds[b] = seed
+        for i, p in zip(buckets[b], pos):
+            slots[p] = i
+    return seeds, slots
+
+
+def buildAnswer(content, mime, etag, maxAge, encoding, vary):
+    headers = StatusLine
+    headers += b"Content-Type:%s\r\n" % mime.encode()
+    headers += b"Content-Length:%d\r\n" % len(content)
+    if encoding:
+        headers += b"Content-Encoding:%s\r\n" % encoding.encode()
+    if vary:
+        headers += b"Vary:Accept-Encoding\r\n"
+    headers += b"ETag:\"%s\"\r\n" % etag.encode()
+    headers += b"Cache-Control:max-age=%d\r\n\r\n" % maxAge
+    return headers + content, len(headers)
+
+
+def toCString(text):
+    """Escape the text for a C string literal: the non printable and non ASCII bytes are written in octal, since a hexadecimal escape
+    would swallow the following hexadecimal digits"""
+    out = []
+    for c in text.encode():
+        if c in b'"\\':
+            out.append("\\" + chr(c))
+        elif c < 0x20 or c >= 0x7F:
+            out.append("\\%03o" % c)
+        else:
+            out.append(chr(c))
+    return "".join(out)
+
+
+def toArray(name, data):
+    lines = []
+    for i in range(0, len(data), 24):
+        lines.append("        " + ", ".join("0x%02x" % c for c in data[i:i + 24]) + ",")
+    return "    inline constexpr uint8 %s[] = {\n%s\n    };\n" % (name, "\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Embed a directory of assets in a C++ header")
+    parser.add_argument("directory")
+    parser.add_argument("output")
+    parser.add_argument("namespace", nargs="?", default="Assets")
+    parser.add_argument("--max-age", type=int, default=3600, help="Cache-Control max-age in seconds")
+    parser.add_argument("--no-gzip", action="store_true", help="Don't store gzip encoded variants")
+    args = parser.parse_args()
+
+    files = []
+    for root, dirs, names in os.walk(args.directory):
+        dirs.sort()
+        for name in sorted(names):
+            path = os.path.join(root, name)
+            # Precompressed siblings are used as the gzip variant of their file
+            if name.endswith(".gz") and os.path.exists(path[:-3]):
+                continue
+            files.append(path)
+    if not files:
+        sys.exit("No asset found in " + args.directory)
+
+    arrays, assets = [], []
+    for index, path in enumerate(files):
+        url = "/" + os.path.relpath(path, args.directory).replace(os.sep, "/")
+        with open(path, "rb") as f:
+            content = f.read()
+        mime = MIMETypes.get(url.rsplit(".", 1)[-1].lower() if "." in url else "", "application/octet-stream")
+        etag = hashlib.sha1(content).hexdigest()[:16]
+
+        compressed = None
+        if os.path.exists(path + ".gz"):
+            with open(path + ".gz", "rb") as f:
+                compressed = f.read()
+        elif not args.no_gzip:
+            compressed = gzip.compress(content, 9, mtime=0)
+            if len(compressed) > len(content) * MinGain:
+                compressed = None
+
+        name = "asset%d_%s" % (index, re.sub(r"[^A-Za-z0-9]", "_", url.strip("/")))
+        answer, headerLength = buildAnswer(content, mime, etag, args.max_age, None, compressed is not None)
+        # Quoted, so a trailing backslash doesn't continue the comment on the next line
+        arrays.append("    // \"%s\"\n" % toCString(url) + toArray(name, answer))
+        gzipEntry = "nullptr, 0, 0"
+        if compressed is not None:
+            gzAnswer, gzHeaderLength = buildAnswer(compressed, mime, etag + "-gz", args.max_age, "gzip", True)
+            arrays.append(toArray(name + "_gz", gzAnswer))
+            gzipEntry = "%s_gz, %d, %d" % (name, gzHeaderLength, len(compressed))
+        entry = "%s, %d, %d, %s" % (name, headerLength, len(content), gzipEntry)
+        assets.append((url, entry))
+        # Directory index
+        if os.path.basename(url) in ("index.html", "index.htm"):
+            assets.append((url[:url.rfind("/") + 1], entry))
+
+    seeds, slots = perfectHash([url.encode() for url, _ in assets])
+    guard = "hpp_%s_hpp" % args.namespace
+    with open(args.output, "w") as out:
+        out.write("// Generated by tools/ROMAssets.py from %s, don't edit\n" % toCString(args.directory))
+        out.write("#ifndef %s\n#define %s\n\n" % (guard, guard))
+        out.write("// We need the asset bundle declaration\n#include \"Network/Servers/ROMAssets.hpp\"\n\n")
+        out.write("namespace %s\n{\n    using namespace Network::Servers::HTTP;\n\n" % args.namespace)
+        out.write("\n".join(arrays))
+        out.write("\n    /** The assets, sorted by their perfect hash index */\n")
+        out.write("    inline constexpr ROMAsset assets[] = {\n")
+        for i in slots:
+            url, entry = assets[i]
+            out.write("        { \"%s\", %d, %s },\n" % (toCString(url), len(url.encode()), entry))
+        out.write("    };\n")
+        out.write("    inline constexpr uint32 seeds[] = { %s };\n\n" % ", ".join(str(s) for s in seeds))
+        out.write("    typedef ROMBundle<assets, seeds> Bundle;\n}\n\n#endif\n")
+
+
+if __name__ == "__main__":
+    main()